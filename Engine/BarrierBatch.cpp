@@ -0,0 +1,177 @@
+#include "BarrierBatch.h"
+
+void BarrierBatch::setSynchronization2(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2)
+{
+	m_vkCmdPipelineBarrier2KHR = cmdPipelineBarrier2;
+}
+
+bool BarrierBatch::synchronization2() const
+{
+	return m_vkCmdPipelineBarrier2KHR != nullptr;
+}
+
+void BarrierBatch::addExecution(VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages)
+{
+	m_srcStages |= srcStages;
+	m_dstStages |= dstStages;
+	m_executions.push_back({ srcStages, dstStages });
+}
+
+void BarrierBatch::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+	uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex)
+{
+	VkBufferMemoryBarrier bufferMemoryBarrier =
+	{
+		VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		nullptr,
+		srcAccess,
+		dstAccess,
+		srcQueueFamilyIndex,
+		dstQueueFamilyIndex,
+		buffer,
+		offset,
+		size,
+	};
+	m_srcStages |= srcStages;
+	m_dstStages |= dstStages;
+	m_bufferBarriers.push_back(bufferMemoryBarrier);
+	m_bufferStages.push_back({ srcStages, dstStages });
+}
+
+void BarrierBatch::addImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+	uint32_t srcQueueFamilyIndex, uint32_t dstQueueFamilyIndex)
+{
+	VkImageMemoryBarrier imageMemoryBarrier =
+	{
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		nullptr,
+		srcAccess,
+		dstAccess,
+		oldLayout,
+		newLayout,
+		srcQueueFamilyIndex,
+		dstQueueFamilyIndex,
+		image,
+		{
+			aspect,
+			0,
+			VK_REMAINING_MIP_LEVELS,
+			0,
+			VK_REMAINING_ARRAY_LAYERS,
+		},
+	};
+	m_srcStages |= srcStages;
+	m_dstStages |= dstStages;
+	m_imageBarriers.push_back(imageMemoryBarrier);
+	m_imageStages.push_back({ srcStages, dstStages });
+}
+
+bool BarrierBatch::empty() const
+{
+	return m_executions.empty() && m_bufferBarriers.empty() && m_imageBarriers.empty();
+}
+
+uint32_t BarrierBatch::barrierCount() const
+{
+	return static_cast<uint32_t>(m_bufferBarriers.size() + m_imageBarriers.size());
+}
+
+void BarrierBatch::flush(VkCommandBuffer commandBuffer)
+{
+	if (empty())
+	{
+		return;
+	}
+	if (m_vkCmdPipelineBarrier2KHR != nullptr)
+	{
+		// the legacy stage and access bits have the same values in the 64 bit flags
+		std::vector<VkMemoryBarrier2KHR> memoryBarriers;
+		for (const Stages& stages : m_executions)
+		{
+			VkMemoryBarrier2KHR memoryBarrier =
+			{
+				VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR,
+				nullptr,
+				stages.m_src,
+				0,
+				stages.m_dst,
+				0,
+			};
+			memoryBarriers.push_back(memoryBarrier);
+		}
+		std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+		for (size_t i = 0; i < m_bufferBarriers.size(); ++i)
+		{
+			const VkBufferMemoryBarrier& barrier = m_bufferBarriers[i];
+			VkBufferMemoryBarrier2KHR bufferBarrier =
+			{
+				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
+				nullptr,
+				m_bufferStages[i].m_src,
+				barrier.srcAccessMask,
+				m_bufferStages[i].m_dst,
+				barrier.dstAccessMask,
+				barrier.srcQueueFamilyIndex,
+				barrier.dstQueueFamilyIndex,
+				barrier.buffer,
+				barrier.offset,
+				barrier.size,
+			};
+			bufferBarriers.push_back(bufferBarrier);
+		}
+		std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+		for (size_t i = 0; i < m_imageBarriers.size(); ++i)
+		{
+			const VkImageMemoryBarrier& barrier = m_imageBarriers[i];
+			VkImageMemoryBarrier2KHR imageBarrier =
+			{
+				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+				nullptr,
+				m_imageStages[i].m_src,
+				barrier.srcAccessMask,
+				m_imageStages[i].m_dst,
+				barrier.dstAccessMask,
+				barrier.oldLayout,
+				barrier.newLayout,
+				barrier.srcQueueFamilyIndex,
+				barrier.dstQueueFamilyIndex,
+				barrier.image,
+				barrier.subresourceRange,
+			};
+			imageBarriers.push_back(imageBarrier);
+		}
+		VkDependencyInfoKHR dependencyInfo =
+		{
+			VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+			nullptr,
+			0,
+			static_cast<uint32_t>(memoryBarriers.size()),
+			memoryBarriers.data(),
+			static_cast<uint32_t>(bufferBarriers.size()),
+			bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()),
+			imageBarriers.data(),
+		};
+		m_vkCmdPipelineBarrier2KHR(commandBuffer, &dependencyInfo);
+	}
+	else
+	{
+		vkCmdPipelineBarrier(commandBuffer,
+			m_srcStages != 0 ? m_srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			m_dstStages != 0 ? m_dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			static_cast<uint32_t>(m_bufferBarriers.size()),
+			m_bufferBarriers.data(),
+			static_cast<uint32_t>(m_imageBarriers.size()),
+			m_imageBarriers.data());
+	}
+	m_srcStages = 0;
+	m_dstStages = 0;
+	m_executions.clear();
+	m_bufferBarriers.clear();
+	m_bufferStages.clear();
+	m_imageBarriers.clear();
+	m_imageStages.clear();
+}
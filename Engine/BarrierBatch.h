@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// collects buffer and image barriers, each with its own stage and access masks, and records
+// them in one call. without VK_KHR_synchronization2 the stage masks of every barrier are merged
+// into a single vkCmdPipelineBarrier, with it each barrier keeps its own stages so one slow
+// producer does not make every consumer in the batch wait
+class BarrierBatch
+{
+public:
+	void setSynchronization2(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2);
+	bool synchronization2() const;
+	void addExecution(VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages);
+	void addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+	void addImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+	bool empty() const;
+	uint32_t barrierCount() const;
+	void flush(VkCommandBuffer commandBuffer);
+private:
+	struct Stages
+	{
+		VkPipelineStageFlags m_src;
+		VkPipelineStageFlags m_dst;
+	};
+	PFN_vkCmdPipelineBarrier2KHR m_vkCmdPipelineBarrier2KHR{ nullptr };
+	VkPipelineStageFlags m_srcStages{ 0 };
+	VkPipelineStageFlags m_dstStages{ 0 };
+	std::vector<Stages> m_executions;
+	std::vector<VkBufferMemoryBarrier> m_bufferBarriers;
+	std::vector<Stages> m_bufferStages;
+	std::vector<VkImageMemoryBarrier> m_imageBarriers;
+	std::vector<Stages> m_imageStages;
+};
@@ -0,0 +1,21 @@
+#include "DeletionQueue.h"
+
+void DeletionQueue::push(uint64_t serial, std::function<void()> deleter)
+{
+	Entry entry = { serial, std::move(deleter) };
+	m_entries.push_back(std::move(entry));
+}
+
+void DeletionQueue::flush(uint64_t completedSerial)
+{
+	while (!m_entries.empty() && m_entries.front().m_serial <= completedSerial)
+	{
+		m_entries.front().m_deleter();
+		m_entries.pop_front();
+	}
+}
+
+size_t DeletionQueue::size() const
+{
+	return m_entries.size();
+}
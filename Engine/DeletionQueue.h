@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// deleters are pushed with the serial of the last submission that may use the object
+// and run once the GPU has completed that serial
+class DeletionQueue
+{
+public:
+	void push(uint64_t serial, std::function<void()> deleter);
+	void flush(uint64_t completedSerial);
+	size_t size() const;
+private:
+	struct Entry
+	{
+		uint64_t m_serial;
+		std::function<void()> m_deleter;
+	};
+	std::deque<Entry> m_entries;
+};
@@ -0,0 +1,135 @@
+#include "DrawList.h"
+#include <algorithm>
+
+uint64_t DrawList::makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, bool depthFirst)
+{
+	uint64_t quantisedDepth = static_cast<uint64_t>((std::min)((std::max)(depth, 0.0f), 1.0f) * 0xffffff);
+	uint64_t state = (static_cast<uint64_t>(material & 0xffff) << 16) | (mesh & 0xffff);
+	uint64_t key = static_cast<uint64_t>(pipeline & 0xff) << 56;
+	if (depthFirst)
+	{
+		return key | (quantisedDepth << 32) | state;
+	}
+	return key | (state << 24) | quantisedDepth;
+}
+
+void DrawList::reset()
+{
+	m_draws.clear();
+	m_entries.clear();
+	m_counters = DrawListCounters();
+}
+
+void DrawList::add(uint64_t key, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t firstVertex, uint32_t vertexCount)
+{
+	m_entries.push_back({ key, static_cast<uint32_t>(m_draws.size()) });
+	m_draws.push_back({ pipeline, material, mesh, firstVertex, vertexCount, 0, false });
+}
+
+void DrawList::addIndexed(uint64_t key, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset)
+{
+	m_entries.push_back({ key, static_cast<uint32_t>(m_draws.size()) });
+	m_draws.push_back({ pipeline, material, mesh, firstIndex, indexCount, vertexOffset, true });
+}
+
+void DrawList::sort()
+{
+	// least significant byte first, a byte every key shares would be a pass that moves nothing
+	m_scratch.resize(m_entries.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		uint32_t histogram[256] = {};
+		for (const SortEntry& entry : m_entries)
+		{
+			++histogram[(entry.m_key >> shift) & 0xff];
+		}
+		if (m_entries.empty() || histogram[(m_entries[0].m_key >> shift) & 0xff] == m_entries.size())
+		{
+			continue;
+		}
+		uint32_t offset = 0;
+		for (uint32_t& count : histogram)
+		{
+			uint32_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+		for (const SortEntry& entry : m_entries)
+		{
+			m_scratch[histogram[(entry.m_key >> shift) & 0xff]++] = entry;
+		}
+		m_entries.swap(m_scratch);
+	}
+}
+
+void DrawList::record(VkCommandBuffer commandBuffer, const DrawBindings& bindings, DrawCallback beforeDraw)
+{
+	m_counters = DrawListCounters();
+	uint32_t boundPipeline = UINT32_MAX;
+	uint32_t boundMaterial = UINT32_MAX;
+	uint32_t boundMesh = UINT32_MAX;
+	bool indexBufferBound = false;
+	for (uint32_t i = 0; i < m_entries.size(); ++i)
+	{
+		const Draw& draw = m_draws[m_entries[i].m_draw];
+		if (draw.m_pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindings.m_pipelines[draw.m_pipeline]);
+			boundPipeline = draw.m_pipeline;
+			++m_counters.m_pipelineBinds;
+		}
+		else
+		{
+			++m_counters.m_pipelineBindsAvoided;
+		}
+		if (draw.m_material != boundMaterial)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindings.m_pipelineLayout, 0, 1, &bindings.m_descriptorSets[draw.m_material], 0, nullptr);
+			boundMaterial = draw.m_material;
+			++m_counters.m_descriptorSetBinds;
+		}
+		else
+		{
+			++m_counters.m_descriptorSetBindsAvoided;
+		}
+		if (draw.m_mesh != boundMesh)
+		{
+			uint32_t firstBuffer = draw.m_mesh * bindings.m_vertexBindingCount;
+			vkCmdBindVertexBuffers(commandBuffer, 0, bindings.m_vertexBindingCount, &bindings.m_vertexBuffers[firstBuffer], &bindings.m_vertexOffsets[firstBuffer]);
+			boundMesh = draw.m_mesh;
+			++m_counters.m_vertexBufferBinds;
+		}
+		else
+		{
+			++m_counters.m_vertexBufferBindsAvoided;
+		}
+		if (beforeDraw)
+		{
+			beforeDraw(commandBuffer, i);
+		}
+		if (draw.m_indexed)
+		{
+			if (!indexBufferBound)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, bindings.m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				indexBufferBound = true;
+			}
+			vkCmdDrawIndexed(commandBuffer, draw.m_count, 1, draw.m_first, draw.m_vertexOffset, 0);
+		}
+		else
+		{
+			vkCmdDraw(commandBuffer, draw.m_count, 1, draw.m_first, 0);
+		}
+		++m_counters.m_draws;
+	}
+}
+
+uint32_t DrawList::size() const
+{
+	return static_cast<uint32_t>(m_entries.size());
+}
+
+const DrawListCounters& DrawList::counters() const
+{
+	return m_counters;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+
+// state a draw refers to by index, the same indices go into the sort key
+struct DrawBindings
+{
+	VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
+	std::vector<VkPipeline> m_pipelines;
+	std::vector<VkDescriptorSet> m_descriptorSets;
+	// m_vertexBindingCount consecutive bindings per mesh, bound from binding 0
+	uint32_t m_vertexBindingCount{ 1 };
+	std::vector<VkBuffer> m_vertexBuffers;
+	std::vector<VkDeviceSize> m_vertexOffsets;
+	// bound once with 32 bit indices before the first indexed draw
+	VkBuffer m_indexBuffer{ VK_NULL_HANDLE };
+};
+
+struct DrawListCounters
+{
+	uint32_t m_draws{ 0 };
+	uint32_t m_pipelineBinds{ 0 };
+	uint32_t m_pipelineBindsAvoided{ 0 };
+	uint32_t m_descriptorSetBinds{ 0 };
+	uint32_t m_descriptorSetBindsAvoided{ 0 };
+	uint32_t m_vertexBufferBinds{ 0 };
+	uint32_t m_vertexBufferBindsAvoided{ 0 };
+};
+
+// draws are collected with a 64 bit key, radix sorted and recorded in key order so draws
+// sharing a pipeline, material and mesh end up next to each other and their binds are issued
+// once. the sort is stable, draws with equal keys keep the order they were added in
+class DrawList
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t drawIndex)> DrawCallback;
+
+	// pipeline 8 bits, material 16, mesh 16, depth 24 quantised from [0, 1]. depth first moves
+	// depth above material and mesh, for front to back opaque passes where early-Z matters more
+	static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, bool depthFirst = false);
+
+	void reset();
+	void add(uint64_t key, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t firstVertex, uint32_t vertexCount);
+	void addIndexed(uint64_t key, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset);
+	void sort();
+	// beforeDraw runs ahead of each draw in sorted order, after its state is bound. the counters
+	// start over with every record, a list recorded twice reports its last recording
+	void record(VkCommandBuffer commandBuffer, const DrawBindings& bindings, DrawCallback beforeDraw = nullptr);
+	uint32_t size() const;
+	const DrawListCounters& counters() const;
+private:
+	struct Draw
+	{
+		uint32_t m_pipeline;
+		uint32_t m_material;
+		uint32_t m_mesh;
+		uint32_t m_first;
+		uint32_t m_count;
+		int32_t m_vertexOffset;
+		bool m_indexed;
+	};
+	struct SortEntry
+	{
+		uint64_t m_key;
+		uint32_t m_draw;
+	};
+	std::vector<Draw> m_draws;
+	std::vector<SortEntry> m_entries;
+	std::vector<SortEntry> m_scratch;
+	DrawListCounters m_counters;
+};
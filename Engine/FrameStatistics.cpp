@@ -0,0 +1,193 @@
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <fstream>
+
+Histogram::Histogram()
+	: m_counts(bucket_count, 0)
+{
+}
+
+uint32_t Histogram::bucketIndex(uint64_t value)
+{
+	if (value < sub_bucket_count)
+	{
+		return static_cast<uint32_t>(value);
+	}
+	uint32_t msb = 0;
+	for (uint32_t step = 32; step > 0; step >>= 1)
+	{
+		if (value >> (msb + step))
+		{
+			msb += step;
+		}
+	}
+	uint32_t shift = msb - (sub_bucket_bits - 1);
+	uint32_t subBucket = static_cast<uint32_t>(value >> shift);
+	return sub_bucket_count + (shift - 1) * (sub_bucket_count / 2) + (subBucket - sub_bucket_count / 2);
+}
+
+uint64_t Histogram::bucketValue(uint32_t index)
+{
+	if (index < sub_bucket_count)
+	{
+		return index;
+	}
+	uint32_t offset = index - sub_bucket_count;
+	uint32_t shift = offset / (sub_bucket_count / 2) + 1;
+	uint64_t subBucket = offset % (sub_bucket_count / 2) + sub_bucket_count / 2;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+void Histogram::record(int64_t value)
+{
+	if (value < 0)
+	{
+		value = 0;
+	}
+	m_counts[bucketIndex(static_cast<uint64_t>(value))]++;
+	m_count++;
+	if (value > m_max)
+	{
+		m_max = value;
+	}
+}
+
+void Histogram::add(const Histogram& other)
+{
+	for (uint32_t i = 0; i < bucket_count; ++i)
+	{
+		m_counts[i] += other.m_counts[i];
+	}
+	m_count += other.m_count;
+	if (other.m_max > m_max)
+	{
+		m_max = other.m_max;
+	}
+}
+
+void Histogram::reset()
+{
+	std::fill(m_counts.begin(), m_counts.end(), 0);
+	m_count = 0;
+	m_max = 0;
+}
+
+uint64_t Histogram::count() const
+{
+	return m_count;
+}
+
+int64_t Histogram::maximum() const
+{
+	return m_max;
+}
+
+int64_t Histogram::percentile(double percentile) const
+{
+	if (0 == m_count)
+	{
+		return 0;
+	}
+	uint64_t target = static_cast<uint64_t>(percentile / 100.0 * m_count + 0.5);
+	if (target < 1)
+	{
+		target = 1;
+	}
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < bucket_count; ++i)
+	{
+		total += m_counts[i];
+		if (total >= target)
+		{
+			int64_t value = static_cast<int64_t>(bucketValue(i));
+			return value < m_max ? value : m_max;
+		}
+	}
+	return m_max;
+}
+
+const char* FrameStatistics::metricName(FrameMetric metric)
+{
+	switch (metric)
+	{
+	case FrameTime:
+		return "frame_time";
+	case AcquireWait:
+		return "acquire_wait";
+	case FenceWait:
+		return "fence_wait";
+	case PresentTime:
+		return "present_time";
+	default:
+		return "unknown";
+	}
+}
+
+void FrameStatistics::setKeepSamples(bool keepSamples)
+{
+	m_keepSamples = keepSamples;
+}
+
+void FrameStatistics::record(const FrameSample& sample, int64_t timestamp)
+{
+	if (m_windows.empty() || timestamp - m_windows.back().m_start >= window_duration)
+	{
+		Window window;
+		window.m_start = timestamp;
+		m_windows.push_back(window);
+		if (m_windows.size() > window_count)
+		{
+			m_windows.pop_front();
+		}
+	}
+	Window& window = m_windows.back();
+	for (uint32_t i = 0; i < FrameMetricCount; ++i)
+	{
+		window.m_histograms[i].record(sample.m_values[i]);
+	}
+	if (m_keepSamples && m_samples.size() < max_kept_samples)
+	{
+		m_samples.push_back(sample);
+	}
+}
+
+MetricSummary FrameStatistics::summary(FrameMetric metric) const
+{
+	Histogram histogram;
+	for (const Window& window : m_windows)
+	{
+		histogram.add(window.m_histograms[metric]);
+	}
+	MetricSummary summary;
+	summary.m_count = histogram.count();
+	summary.m_p50 = histogram.percentile(50);
+	summary.m_p95 = histogram.percentile(95);
+	summary.m_p99 = histogram.percentile(99);
+	summary.m_max = histogram.maximum();
+	return summary;
+}
+
+bool FrameStatistics::writeCsv(const std::string& fileName) const
+{
+	std::ofstream file(fileName);
+	if (file.fail())
+	{
+		return false;
+	}
+	file << "frame";
+	for (uint32_t i = 0; i < FrameMetricCount; ++i)
+	{
+		file << "," << metricName(static_cast<FrameMetric>(i)) << "_us";
+	}
+	file << "\n";
+	for (size_t frame = 0; frame < m_samples.size(); ++frame)
+	{
+		file << frame;
+		for (uint32_t i = 0; i < FrameMetricCount; ++i)
+		{
+			file << "," << m_samples[frame].m_values[i];
+		}
+		file << "\n";
+	}
+	return !file.fail();
+}
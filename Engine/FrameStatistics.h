@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// log-linear histogram in the spirit of HdrHistogram: every power of two range is split
+// into sub_bucket_count / 2 linear buckets, so any recorded value keeps ~3% precision
+class Histogram
+{
+public:
+	Histogram();
+	void record(int64_t value);
+	void add(const Histogram& other);
+	void reset();
+	uint64_t count() const;
+	int64_t maximum() const;
+	int64_t percentile(double percentile) const;
+private:
+	static uint32_t bucketIndex(uint64_t value);
+	static uint64_t bucketValue(uint32_t index);
+	static const uint32_t sub_bucket_bits = 5;
+	static const uint32_t sub_bucket_count = 1 << sub_bucket_bits;
+	static const uint32_t bucket_count = sub_bucket_count + (64 - sub_bucket_bits) * (sub_bucket_count / 2);
+	std::vector<uint64_t> m_counts;
+	uint64_t m_count{ 0 };
+	int64_t m_max{ 0 };
+};
+
+enum FrameMetric
+{
+	FrameTime,
+	AcquireWait,
+	FenceWait,
+	PresentTime,
+	FrameMetricCount,
+};
+
+struct FrameSample
+{
+	int64_t m_values[FrameMetricCount]{};
+};
+
+struct MetricSummary
+{
+	uint64_t m_count{ 0 };
+	int64_t m_p50{ 0 };
+	int64_t m_p95{ 0 };
+	int64_t m_p99{ 0 };
+	int64_t m_max{ 0 };
+};
+
+// frame samples are in microseconds, summaries cover the last window_count windows
+class FrameStatistics
+{
+public:
+	static const char* metricName(FrameMetric metric);
+
+	void setKeepSamples(bool keepSamples);
+	void record(const FrameSample& sample, int64_t timestamp);
+	MetricSummary summary(FrameMetric metric) const;
+	bool writeCsv(const std::string& fileName) const;
+private:
+	struct Window
+	{
+		int64_t m_start{ 0 };
+		Histogram m_histograms[FrameMetricCount];
+	};
+	static const uint32_t window_count = 10;
+	static const int64_t window_duration = 1000000;
+	static const size_t max_kept_samples = 1 << 20;
+	std::deque<Window> m_windows;
+	bool m_keepSamples{ false };
+	std::vector<FrameSample> m_samples;
+};
@@ -0,0 +1,410 @@
+#include "GpuProfiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static int64_t HostTimestampToNanoseconds(uint64_t timestamp)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+	return static_cast<int64_t>(timestamp / ticksPerSecond * 1000000000ULL + timestamp % ticksPerSecond * 1000000000ULL / ticksPerSecond);
+#else
+	return static_cast<int64_t>(timestamp);
+#endif
+}
+
+bool GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount,
+	PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps, VkTimeDomainEXT hostTimeDomain)
+{
+	VkResult result;
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+	if (queueFamilyIndex >= queueFamilyCount)
+	{
+		return false;
+	}
+	uint32_t timestampValidBits = queueFamilyProperties[queueFamilyIndex].timestampValidBits;
+	if (0 == timestampValidBits || 0 == physicalDeviceProperties.limits.timestampPeriod)
+	{
+		return false;
+	}
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		nullptr,
+		0,
+		VK_QUERY_TYPE_TIMESTAMP,
+		slotCount * max_queries_per_slot,
+		0,
+	};
+	result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &m_queryPool);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	m_device = device;
+	m_timestampPeriod = physicalDeviceProperties.limits.timestampPeriod;
+	m_timestampMask = timestampValidBits >= 64 ? UINT64_MAX : (1ULL << timestampValidBits) - 1;
+	m_slots.resize(slotCount);
+	m_vkGetCalibratedTimestampsEXT = getCalibratedTimestamps;
+	m_hostTimeDomain = hostTimeDomain;
+	calibrate();
+	return true;
+}
+
+bool GpuProfiler::initPipelineStatistics()
+{
+	if (!enabled())
+	{
+		return false;
+	}
+	VkQueryPoolCreateInfo queryPoolCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		nullptr,
+		0,
+		VK_QUERY_TYPE_PIPELINE_STATISTICS,
+		static_cast<uint32_t>(m_slots.size()) * max_statistics_per_slot,
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT,
+	};
+	VkResult result = vkCreateQueryPool(m_device, &queryPoolCreateInfo, nullptr, &m_statisticsQueryPool);
+	if (result != VK_SUCCESS)
+	{
+		m_statisticsQueryPool = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+void GpuProfiler::calibrate()
+{
+	if (nullptr == m_vkGetCalibratedTimestampsEXT)
+	{
+		return;
+	}
+	VkCalibratedTimestampInfoEXT calibratedTimestampInfos[] =
+	{
+		{
+			VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+			nullptr,
+			VK_TIME_DOMAIN_DEVICE_EXT,
+		},
+		{
+			VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+			nullptr,
+			m_hostTimeDomain,
+		},
+	};
+	uint64_t timestamps[2];
+	uint64_t maxDeviation;
+	if (m_vkGetCalibratedTimestampsEXT(m_device, 2, calibratedTimestampInfos, timestamps, &maxDeviation) == VK_SUCCESS)
+	{
+		m_calibrationTicks = timestamps[0];
+		m_calibrationHostTime = HostTimestampToNanoseconds(timestamps[1]);
+		m_lastCalibration = Tracer::now();
+		m_calibrated = true;
+	}
+}
+
+int64_t GpuProfiler::toHostTime(uint64_t ticks) const
+{
+	// sign extend the wrapped difference so timestamps taken just before calibration stay in place
+	int64_t delta = static_cast<int64_t>((ticks - m_calibrationTicks) & m_timestampMask);
+	if (m_timestampMask != UINT64_MAX && static_cast<uint64_t>(delta) > m_timestampMask / 2)
+	{
+		delta -= static_cast<int64_t>(m_timestampMask) + 1;
+	}
+	return m_calibrationHostTime + static_cast<int64_t>(delta * m_timestampPeriod);
+}
+
+void GpuProfiler::clear()
+{
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+		m_queryPool = VK_NULL_HANDLE;
+	}
+	if (m_statisticsQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_device, m_statisticsQueryPool, nullptr);
+		m_statisticsQueryPool = VK_NULL_HANDLE;
+	}
+	m_slots.clear();
+	m_history.clear();
+	m_pipelineHistory.clear();
+}
+
+bool GpuProfiler::enabled() const
+{
+	return m_queryPool != VK_NULL_HANDLE;
+}
+
+bool GpuProfiler::pipelineStatisticsEnabled() const
+{
+	return m_statisticsQueryPool != VK_NULL_HANDLE;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+	if (!enabled())
+	{
+		return;
+	}
+	resolve(slot);
+	if (Tracer::now() - m_lastCalibration > 1000000000LL)
+	{
+		calibrate();
+	}
+	m_currentSlot = slot;
+	m_slots[slot].m_scopes.clear();
+	m_slots[slot].m_queryCount = 0;
+	m_slots[slot].m_statisticsNames.clear();
+	m_slots[slot].m_pending = true;
+	vkCmdResetQueryPool(commandBuffer, m_queryPool, slot * max_queries_per_slot, max_queries_per_slot);
+	if (pipelineStatisticsEnabled())
+	{
+		vkCmdResetQueryPool(commandBuffer, m_statisticsQueryPool, slot * max_statistics_per_slot, max_statistics_per_slot);
+	}
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!enabled())
+	{
+		return UINT32_MAX;
+	}
+	Slot& slot = m_slots[m_currentSlot];
+	if (slot.m_queryCount + 2 > max_queries_per_slot)
+	{
+		return UINT32_MAX;
+	}
+	Scope scope =
+	{
+		name,
+		slot.m_queryCount++,
+		UINT32_MAX,
+	};
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, m_currentSlot * max_queries_per_slot + scope.m_beginQuery);
+	slot.m_scopes.push_back(scope);
+	return static_cast<uint32_t>(slot.m_scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+	if (!enabled() || scope == UINT32_MAX)
+	{
+		return;
+	}
+	Slot& slot = m_slots[m_currentSlot];
+	slot.m_scopes[scope].m_endQuery = slot.m_queryCount++;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, m_currentSlot * max_queries_per_slot + slot.m_scopes[scope].m_endQuery);
+}
+
+uint32_t GpuProfiler::beginPipelineStatistics(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!pipelineStatisticsEnabled())
+	{
+		return UINT32_MAX;
+	}
+	Slot& slot = m_slots[m_currentSlot];
+	if (slot.m_statisticsNames.size() >= max_statistics_per_slot)
+	{
+		return UINT32_MAX;
+	}
+	uint32_t query = static_cast<uint32_t>(slot.m_statisticsNames.size());
+	slot.m_statisticsNames.push_back(name);
+	vkCmdBeginQuery(commandBuffer, m_statisticsQueryPool, m_currentSlot * max_statistics_per_slot + query, 0);
+	return query;
+}
+
+void GpuProfiler::endPipelineStatistics(VkCommandBuffer commandBuffer, uint32_t query)
+{
+	if (!pipelineStatisticsEnabled() || query == UINT32_MAX)
+	{
+		return;
+	}
+	vkCmdEndQuery(commandBuffer, m_statisticsQueryPool, m_currentSlot * max_statistics_per_slot + query);
+}
+
+void GpuProfiler::resolve(uint32_t slotIndex)
+{
+	if (!enabled())
+	{
+		return;
+	}
+	Slot& slot = m_slots[slotIndex];
+	if (!slot.m_pending || 0 == slot.m_queryCount)
+	{
+		return;
+	}
+	resolvePipelineStatistics(slot, slotIndex);
+
+	// value and availability pairs, no wait flag so a slot that is still in flight never stalls
+	uint64_t results[max_queries_per_slot * 2];
+	VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, slotIndex * max_queries_per_slot, slot.m_queryCount,
+		sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		return;
+	}
+	for (const Scope& scope : slot.m_scopes)
+	{
+		if (scope.m_endQuery == UINT32_MAX)
+		{
+			continue;
+		}
+		const uint64_t* begin = &results[scope.m_beginQuery * 2];
+		const uint64_t* end = &results[scope.m_endQuery * 2];
+		if (0 == begin[1] || 0 == end[1])
+		{
+			continue;
+		}
+		uint64_t ticks = (end[0] - begin[0]) & m_timestampMask;
+		addSample(scope.m_name, ticks * m_timestampPeriod / 1e6);
+		if (m_calibrated && Tracer::instance().enabled())
+		{
+			Tracer::instance().addEvent(scope.m_name, Tracer::gpu_thread_id, toHostTime(begin[0]), static_cast<int64_t>(ticks * m_timestampPeriod));
+		}
+	}
+	slot.m_pending = false;
+}
+
+void GpuProfiler::resolvePipelineStatistics(Slot& slot, uint32_t slotIndex)
+{
+	if (!pipelineStatisticsEnabled() || slot.m_statisticsNames.empty())
+	{
+		return;
+	}
+	const uint32_t stride = pipeline_counter_count + 1;
+	uint64_t results[max_statistics_per_slot * stride];
+	uint32_t queryCount = static_cast<uint32_t>(slot.m_statisticsNames.size());
+	VkResult result = vkGetQueryPoolResults(m_device, m_statisticsQueryPool, slotIndex * max_statistics_per_slot, queryCount,
+		sizeof(results), results, sizeof(uint64_t) * stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		return;
+	}
+	std::vector<size_t> updated;
+	for (uint32_t i = 0; i < queryCount; ++i)
+	{
+		const uint64_t* counters = &results[i * stride];
+		if (0 == counters[pipeline_counter_count])
+		{
+			continue;
+		}
+		const char* name = slot.m_statisticsNames[i];
+		auto it = std::find_if(m_pipelineHistory.begin(), m_pipelineHistory.end(), [name](const PipelineHistory& history) { return strcmp(history.m_name, name) == 0; });
+		if (it == m_pipelineHistory.end())
+		{
+			PipelineHistory history;
+			history.m_name = name;
+			m_pipelineHistory.push_back(history);
+			it = m_pipelineHistory.end() - 1;
+		}
+		size_t index = it - m_pipelineHistory.begin();
+		if (std::find(updated.begin(), updated.end(), index) == updated.end())
+		{
+			it->m_samples.push_back(Counters());
+			if (it->m_samples.size() > history_size)
+			{
+				it->m_samples.pop_front();
+			}
+			updated.push_back(index);
+		}
+		for (uint32_t j = 0; j < pipeline_counter_count; ++j)
+		{
+			it->m_samples.back().m_values[j] += counters[j];
+		}
+	}
+}
+
+void GpuProfiler::addSample(const char* name, double milliseconds)
+{
+	auto it = std::find_if(m_history.begin(), m_history.end(), [name](const History& history) { return strcmp(history.m_name, name) == 0; });
+	if (it == m_history.end())
+	{
+		History history;
+		history.m_name = name;
+		m_history.push_back(history);
+		it = m_history.end() - 1;
+	}
+	it->m_samples.push_back(milliseconds);
+	if (it->m_samples.size() > history_size)
+	{
+		it->m_samples.pop_front();
+	}
+}
+
+std::vector<GpuScopeStatistics> GpuProfiler::statistics() const
+{
+	std::vector<GpuScopeStatistics> statistics;
+	for (const History& history : m_history)
+	{
+		if (history.m_samples.empty())
+		{
+			continue;
+		}
+		std::vector<double> samples(history.m_samples.begin(), history.m_samples.end());
+		std::sort(samples.begin(), samples.end());
+		double total = 0;
+		for (double sample : samples)
+		{
+			total += sample;
+		}
+		GpuScopeStatistics scopeStatistics;
+		scopeStatistics.m_name = history.m_name;
+		scopeStatistics.m_sampleCount = static_cast<uint32_t>(samples.size());
+		scopeStatistics.m_min = samples.front();
+		scopeStatistics.m_average = total / samples.size();
+		scopeStatistics.m_p99 = samples[(samples.size() - 1) * 99 / 100];
+		statistics.push_back(scopeStatistics);
+	}
+	return statistics;
+}
+
+std::vector<GpuPipelineStatistics> GpuProfiler::pipelineStatistics() const
+{
+	std::vector<GpuPipelineStatistics> statistics;
+	for (const PipelineHistory& history : m_pipelineHistory)
+	{
+		if (history.m_samples.empty())
+		{
+			continue;
+		}
+		double totals[pipeline_counter_count] = {};
+		for (const Counters& counters : history.m_samples)
+		{
+			for (uint32_t i = 0; i < pipeline_counter_count; ++i)
+			{
+				totals[i] += static_cast<double>(counters.m_values[i]);
+			}
+		}
+		double sampleCount = static_cast<double>(history.m_samples.size());
+		GpuPipelineStatistics pipelineStatistics;
+		pipelineStatistics.m_name = history.m_name;
+		pipelineStatistics.m_sampleCount = static_cast<uint32_t>(history.m_samples.size());
+		pipelineStatistics.m_inputPrimitives = totals[0] / sampleCount;
+		pipelineStatistics.m_vertexInvocations = totals[1] / sampleCount;
+		pipelineStatistics.m_clippingInvocations = totals[2] / sampleCount;
+		pipelineStatistics.m_clippingPrimitives = totals[3] / sampleCount;
+		pipelineStatistics.m_fragmentInvocations = totals[4] / sampleCount;
+		statistics.push_back(pipelineStatistics);
+	}
+	return statistics;
+}
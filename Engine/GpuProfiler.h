@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+
+struct GpuScopeStatistics
+{
+	const char* m_name{ nullptr };
+	uint32_t m_sampleCount{ 0 };
+	double m_min{ 0 };
+	double m_average{ 0 };
+	double m_p99{ 0 };
+};
+
+struct GpuPipelineStatistics
+{
+	const char* m_name{ nullptr };
+	uint32_t m_sampleCount{ 0 };
+	double m_inputPrimitives{ 0 };
+	double m_vertexInvocations{ 0 };
+	double m_clippingInvocations{ 0 };
+	double m_clippingPrimitives{ 0 };
+	double m_fragmentInvocations{ 0 };
+};
+
+// timestamp queries grouped in one slot per frame in flight, results are read back
+// without waiting when the slot is reused, scope names must be string literals.
+// with VK_EXT_calibrated_timestamps the scopes are also forwarded to the Tracer
+// on the steady_clock timeline. pipeline statistics queries are optional, they must not
+// overlap each other and repeated names within a frame are summed into one sample
+class GpuProfiler
+{
+public:
+	bool init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount,
+		PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr, VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT);
+	bool initPipelineStatistics();
+	void clear();
+	bool enabled() const;
+	bool pipelineStatisticsEnabled() const;
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t slot);
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+	uint32_t beginPipelineStatistics(VkCommandBuffer commandBuffer, const char* name);
+	void endPipelineStatistics(VkCommandBuffer commandBuffer, uint32_t query);
+	void resolve(uint32_t slot);
+	std::vector<GpuScopeStatistics> statistics() const;
+	std::vector<GpuPipelineStatistics> pipelineStatistics() const;
+private:
+	struct Scope
+	{
+		const char* m_name;
+		uint32_t m_beginQuery;
+		uint32_t m_endQuery;
+	};
+	struct Slot
+	{
+		std::vector<Scope> m_scopes;
+		uint32_t m_queryCount{ 0 };
+		std::vector<const char*> m_statisticsNames;
+		bool m_pending{ false };
+	};
+	struct History
+	{
+		const char* m_name;
+		std::deque<double> m_samples;
+	};
+	static const uint32_t pipeline_counter_count = 5;
+	struct Counters
+	{
+		uint64_t m_values[pipeline_counter_count]{};
+	};
+	struct PipelineHistory
+	{
+		const char* m_name;
+		std::deque<Counters> m_samples;
+	};
+	void addSample(const char* name, double milliseconds);
+	void resolvePipelineStatistics(Slot& slot, uint32_t slotIndex);
+	void calibrate();
+	int64_t toHostTime(uint64_t ticks) const;
+private:
+	static const uint32_t max_queries_per_slot = 64;
+	static const uint32_t history_size = 256;
+	static const uint32_t max_statistics_per_slot = 16;
+	VkDevice m_device{ VK_NULL_HANDLE };
+	VkQueryPool m_queryPool{ VK_NULL_HANDLE };
+	VkQueryPool m_statisticsQueryPool{ VK_NULL_HANDLE };
+	double m_timestampPeriod{ 1.0 };
+	uint64_t m_timestampMask{ 0 };
+	uint32_t m_currentSlot{ 0 };
+	PFN_vkGetCalibratedTimestampsEXT m_vkGetCalibratedTimestampsEXT{ nullptr };
+	VkTimeDomainEXT m_hostTimeDomain{ VK_TIME_DOMAIN_DEVICE_EXT };
+	bool m_calibrated{ false };
+	uint64_t m_calibrationTicks{ 0 };
+	int64_t m_calibrationHostTime{ 0 };
+	int64_t m_lastCalibration{ 0 };
+	std::vector<Slot> m_slots;
+	std::vector<History> m_history;
+	std::vector<PipelineHistory> m_pipelineHistory;
+};
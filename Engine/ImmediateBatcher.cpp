@@ -0,0 +1,114 @@
+#include "ImmediateBatcher.h"
+#include <cstring>
+
+void ImmediateBatcher::begin()
+{
+	for (Batch& batch : m_batches)
+	{
+		batch.m_primitives = 0;
+		batch.m_vertices.clear();
+		batch.m_indices.clear();
+	}
+	m_current = UINT32_MAX;
+	m_statistics = ImmediateStatistics();
+}
+
+void ImmediateBatcher::setState(uint32_t pipeline, uint32_t texture)
+{
+	for (uint32_t i = 0; i < m_batches.size(); ++i)
+	{
+		if (m_batches[i].m_pipeline == pipeline && m_batches[i].m_texture == texture)
+		{
+			m_current = i;
+			return;
+		}
+	}
+	Batch batch;
+	batch.m_pipeline = pipeline;
+	batch.m_texture = texture;
+	batch.m_primitives = 0;
+	m_batches.push_back(batch);
+	m_current = static_cast<uint32_t>(m_batches.size() - 1);
+}
+
+void ImmediateBatcher::quad(float left, float top, float right, float bottom, float depth, float u0, float v0, float u1, float v1)
+{
+	// same winding as the tutorial's triangle strips
+	const ImmediateVertex vertices[] =
+	{
+		{ left, top, depth, 1.0f, u0, v0 },
+		{ left, bottom, depth, 1.0f, u0, v1 },
+		{ right, top, depth, 1.0f, u1, v0 },
+		{ right, bottom, depth, 1.0f, u1, v1 },
+	};
+	const uint32_t indices[] = { 0, 1, 2, 2, 1, 3 };
+	triangles(vertices, 4, indices, 6);
+}
+
+void ImmediateBatcher::line(float x0, float y0, float x1, float y1, float depth)
+{
+	if (m_current == UINT32_MAX)
+	{
+		setState(0, 0);
+	}
+	Batch& batch = m_batches[m_current];
+	uint32_t base = static_cast<uint32_t>(batch.m_vertices.size());
+	batch.m_vertices.push_back({ x0, y0, depth, 1.0f, 0.0f, 0.0f });
+	batch.m_vertices.push_back({ x1, y1, depth, 1.0f, 1.0f, 0.0f });
+	batch.m_indices.push_back(base);
+	batch.m_indices.push_back(base + 1);
+	++batch.m_primitives;
+	++m_statistics.m_primitives;
+}
+
+void ImmediateBatcher::triangles(const ImmediateVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	if (m_current == UINT32_MAX)
+	{
+		setState(0, 0);
+	}
+	Batch& batch = m_batches[m_current];
+	uint32_t base = static_cast<uint32_t>(batch.m_vertices.size());
+	batch.m_vertices.insert(batch.m_vertices.end(), vertices, vertices + vertexCount);
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		batch.m_indices.push_back(base + indices[i]);
+	}
+	batch.m_primitives += indexCount / 3;
+	m_statistics.m_primitives += indexCount / 3;
+}
+
+void ImmediateBatcher::end(StreamBuffer& streamBuffer, uint32_t mesh, DrawList& drawList)
+{
+	for (const Batch& batch : m_batches)
+	{
+		if (batch.m_indices.empty())
+		{
+			continue;
+		}
+		// vertex offsets are counted in vertices, so vertex data is aligned to the vertex size
+		VkDeviceSize vertexBytes = batch.m_vertices.size() * sizeof(ImmediateVertex);
+		VkDeviceSize indexBytes = batch.m_indices.size() * sizeof(uint32_t);
+		void* vertexData = nullptr;
+		void* indexData = nullptr;
+		VkDeviceSize vertexOffset = 0;
+		VkDeviceSize indexOffset = 0;
+		if (!streamBuffer.allocate(vertexBytes, sizeof(ImmediateVertex), vertexData, vertexOffset)
+			|| !streamBuffer.allocate(indexBytes, sizeof(uint32_t), indexData, indexOffset))
+		{
+			m_statistics.m_droppedPrimitives += batch.m_primitives;
+			continue;
+		}
+		memcpy(vertexData, batch.m_vertices.data(), static_cast<size_t>(vertexBytes));
+		memcpy(indexData, batch.m_indices.data(), static_cast<size_t>(indexBytes));
+		drawList.addIndexed(DrawList::makeKey(batch.m_pipeline, batch.m_texture, mesh, 0.0f), batch.m_pipeline, batch.m_texture, mesh,
+			static_cast<uint32_t>(indexOffset / sizeof(uint32_t)), static_cast<uint32_t>(batch.m_indices.size()), static_cast<int32_t>(vertexOffset / sizeof(ImmediateVertex)));
+		++m_statistics.m_batches;
+		m_statistics.m_bytes += vertexBytes + indexBytes;
+	}
+}
+
+const ImmediateStatistics& ImmediateBatcher::statistics() const
+{
+	return m_statistics;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "StreamBuffer.h"
+#include "DrawList.h"
+
+// clip space position and texture coordinate, the layout of the tutorial vertices
+struct ImmediateVertex
+{
+	float x, y, z, w;
+	float u, v;
+};
+
+struct ImmediateStatistics
+{
+	uint32_t m_primitives{ 0 };
+	uint32_t m_batches{ 0 };
+	uint32_t m_droppedPrimitives{ 0 };
+	VkDeviceSize m_bytes{ 0 };
+};
+
+// immediate mode geometry for debug lines, text and ui. primitives go into one batch per
+// pipeline and texture, end() copies every batch into the frame's stream buffer region and adds
+// one indexed draw per batch. primitives of different batches are not ordered against each
+// other, draws come out sorted by pipeline then texture. line() needs a line list pipeline,
+// quad() and triangles() a triangle list one
+class ImmediateBatcher
+{
+public:
+	void begin();
+	void setState(uint32_t pipeline, uint32_t texture);
+	void quad(float left, float top, float right, float bottom, float depth, float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f);
+	void line(float x0, float y0, float x1, float y1, float depth);
+	void triangles(const ImmediateVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	void end(StreamBuffer& streamBuffer, uint32_t mesh, DrawList& drawList);
+	const ImmediateStatistics& statistics() const;
+private:
+	struct Batch
+	{
+		uint32_t m_pipeline;
+		uint32_t m_texture;
+		uint32_t m_primitives;
+		std::vector<ImmediateVertex> m_vertices;
+		std::vector<uint32_t> m_indices;
+	};
+	// batches are kept across frames so their vectors keep their capacity
+	std::vector<Batch> m_batches;
+	uint32_t m_current{ 0 };
+	ImmediateStatistics m_statistics;
+};
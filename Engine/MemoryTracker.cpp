@@ -0,0 +1,136 @@
+#include "MemoryTracker.h"
+
+const char* MemoryTracker::categoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+	case TextureMemory:
+		return "texture";
+	case VertexMemory:
+		return "vertex";
+	case UniformMemory:
+		return "uniform";
+	case StagingMemory:
+		return "staging";
+	case RenderTargetMemory:
+		return "render target";
+	case ReadbackMemory:
+		return "readback";
+	default:
+		return "unknown";
+	}
+}
+
+void MemoryTracker::init(VkPhysicalDevice physicalDevice, PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2)
+{
+	m_physicalDevice = physicalDevice;
+	m_vkGetPhysicalDeviceMemoryProperties2KHR = getMemoryProperties2;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+	m_typeAllocated.assign(m_memoryProperties.memoryTypeCount, 0);
+	m_heaps.assign(m_memoryProperties.memoryHeapCount, MemoryHeapUsage());
+	m_overThreshold.assign(m_memoryProperties.memoryHeapCount, false);
+	for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+	{
+		m_heaps[i].m_size = m_memoryProperties.memoryHeaps[i].size;
+	}
+	update();
+}
+
+VkResult MemoryTracker::allocate(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* deviceMemory)
+{
+	VkResult result = vkAllocateMemory(device, &allocateInfo, nullptr, deviceMemory);
+	if (result != VK_SUCCESS)
+	{
+		return result;
+	}
+	Allocation allocation =
+	{
+		allocateInfo.allocationSize,
+		allocateInfo.memoryTypeIndex,
+		category,
+	};
+	m_allocations[*deviceMemory] = allocation;
+	m_categoryAllocated[category] += allocation.m_size;
+	m_typeAllocated[allocation.m_memoryTypeIndex] += allocation.m_size;
+	MemoryHeapUsage& heap = m_heaps[m_memoryProperties.memoryTypes[allocation.m_memoryTypeIndex].heapIndex];
+	heap.m_allocated += allocation.m_size;
+	heap.m_allocationCount++;
+	return result;
+}
+
+void MemoryTracker::free(VkDevice device, VkDeviceMemory deviceMemory)
+{
+	if (deviceMemory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	auto it = m_allocations.find(deviceMemory);
+	if (it != m_allocations.end())
+	{
+		const Allocation& allocation = it->second;
+		m_categoryAllocated[allocation.m_category] -= allocation.m_size;
+		m_typeAllocated[allocation.m_memoryTypeIndex] -= allocation.m_size;
+		MemoryHeapUsage& heap = m_heaps[m_memoryProperties.memoryTypes[allocation.m_memoryTypeIndex].heapIndex];
+		heap.m_allocated -= allocation.m_size;
+		heap.m_allocationCount--;
+		m_allocations.erase(it);
+	}
+	vkFreeMemory(device, deviceMemory, nullptr);
+}
+
+void MemoryTracker::setEvictionCallback(EvictionCallback callback, double threshold)
+{
+	m_evictionCallback = callback;
+	m_threshold = threshold;
+}
+
+void MemoryTracker::update()
+{
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudgetProperties =
+	{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+		nullptr,
+	};
+	if (budgetSupported())
+	{
+		VkPhysicalDeviceMemoryProperties2KHR memoryProperties2 =
+		{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR,
+			&memoryBudgetProperties,
+		};
+		m_vkGetPhysicalDeviceMemoryProperties2KHR(m_physicalDevice, &memoryProperties2);
+	}
+	for (uint32_t i = 0; i < m_heaps.size(); ++i)
+	{
+		MemoryHeapUsage& heap = m_heaps[i];
+		heap.m_usage = budgetSupported() ? memoryBudgetProperties.heapUsage[i] : heap.m_allocated;
+		heap.m_budget = budgetSupported() ? memoryBudgetProperties.heapBudget[i] : heap.m_size;
+		bool overThreshold = heap.m_budget > 0 && heap.m_usage > heap.m_budget * m_threshold;
+		// the hook fires once when a heap crosses the threshold, not on every frame above it
+		if (overThreshold && !m_overThreshold[i] && m_evictionCallback)
+		{
+			m_evictionCallback(i, heap);
+		}
+		m_overThreshold[i] = overThreshold;
+	}
+}
+
+bool MemoryTracker::budgetSupported() const
+{
+	return m_vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+}
+
+VkDeviceSize MemoryTracker::allocated(MemoryCategory category) const
+{
+	return m_categoryAllocated[category];
+}
+
+VkDeviceSize MemoryTracker::allocatedByType(uint32_t memoryTypeIndex) const
+{
+	return memoryTypeIndex < m_typeAllocated.size() ? m_typeAllocated[memoryTypeIndex] : 0;
+}
+
+const std::vector<MemoryHeapUsage>& MemoryTracker::heaps() const
+{
+	return m_heaps;
+}
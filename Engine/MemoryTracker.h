@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+enum MemoryCategory
+{
+	TextureMemory,
+	VertexMemory,
+	UniformMemory,
+	StagingMemory,
+	RenderTargetMemory,
+	ReadbackMemory,
+	MemoryCategoryCount,
+};
+
+struct MemoryHeapUsage
+{
+	VkDeviceSize m_size{ 0 };
+	VkDeviceSize m_allocated{ 0 };
+	VkDeviceSize m_usage{ 0 };
+	VkDeviceSize m_budget{ 0 };
+	uint32_t m_allocationCount{ 0 };
+};
+
+// every vkAllocateMemory / vkFreeMemory goes through the tracker so allocations are known by
+// heap, memory type and category. without VK_EXT_memory_budget usage falls back to the tracked
+// bytes and budget to the heap size
+class MemoryTracker
+{
+public:
+	typedef std::function<void(uint32_t heapIndex, const MemoryHeapUsage& usage)> EvictionCallback;
+
+	static const char* categoryName(MemoryCategory category);
+
+	void init(VkPhysicalDevice physicalDevice, PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr);
+	VkResult allocate(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* deviceMemory);
+	void free(VkDevice device, VkDeviceMemory deviceMemory);
+	void setEvictionCallback(EvictionCallback callback, double threshold = 0.9);
+	void update();
+	bool budgetSupported() const;
+	VkDeviceSize allocated(MemoryCategory category) const;
+	VkDeviceSize allocatedByType(uint32_t memoryTypeIndex) const;
+	const std::vector<MemoryHeapUsage>& heaps() const;
+private:
+	struct Allocation
+	{
+		VkDeviceSize m_size;
+		uint32_t m_memoryTypeIndex;
+		MemoryCategory m_category;
+	};
+	VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_vkGetPhysicalDeviceMemoryProperties2KHR{ nullptr };
+	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+	std::unordered_map<VkDeviceMemory, Allocation> m_allocations;
+	VkDeviceSize m_categoryAllocated[MemoryCategoryCount]{};
+	std::vector<VkDeviceSize> m_typeAllocated;
+	std::vector<MemoryHeapUsage> m_heaps;
+	std::vector<bool> m_overThreshold;
+	EvictionCallback m_evictionCallback;
+	double m_threshold{ 0.9 };
+};
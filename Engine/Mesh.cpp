@@ -0,0 +1,358 @@
+#include "Mesh.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// a whole token or part of one as a decimal integer, empty or trailing characters fail
+static bool ParseObjInteger(const std::string& token, size_t begin, size_t end, int64_t& value)
+{
+	std::string number = token.substr(begin, end - begin);
+	char* parsed = nullptr;
+	errno = 0;
+	value = strtoll(number.c_str(), &parsed, 10);
+	return !number.empty() && errno == 0 && parsed == number.c_str() + number.size();
+}
+
+static bool ParseObjIndex(const std::string& token, size_t positionCount, size_t texcoordCount, int64_t& position, int64_t& texcoord)
+{
+	// v, v/vt, v//vn or v/vt/vn, negative indices count back from the last element and 0 is
+	// no index at all. a missing texture coordinate comes back as -1
+	size_t slash = token.find('/');
+	if (!ParseObjInteger(token, 0, (std::min)(slash, token.size()), position) || position == 0)
+	{
+		return false;
+	}
+	position = position < 0 ? static_cast<int64_t>(positionCount) + position : position - 1;
+	texcoord = -1;
+	if (slash != std::string::npos && slash + 1 < token.size() && token[slash + 1] != '/')
+	{
+		if (!ParseObjInteger(token, slash + 1, (std::min)(token.find('/', slash + 1), token.size()), texcoord) || texcoord == 0)
+		{
+			return false;
+		}
+		texcoord = texcoord < 0 ? static_cast<int64_t>(texcoordCount) + texcoord : texcoord - 1;
+		if (texcoord < 0 || texcoord >= static_cast<int64_t>(texcoordCount))
+		{
+			return false;
+		}
+	}
+	return position >= 0 && position < static_cast<int64_t>(positionCount);
+}
+
+bool LoadObj(const char* fileName, MeshData& mesh)
+{
+	std::ifstream file(fileName);
+	if (!file)
+	{
+		std::cout << "Could not open mesh " << fileName << std::endl;
+		return false;
+	}
+	mesh = MeshData();
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::unordered_map<uint64_t, uint32_t> vertexIndices;
+	std::vector<uint32_t> face;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+		if (type == "v")
+		{
+			float x = 0, y = 0, z = 0;
+			stream >> x >> y >> z;
+			positions.insert(positions.end(), { x, y, z });
+		}
+		else if (type == "vt")
+		{
+			float u = 0, v = 0;
+			stream >> u >> v;
+			texcoords.insert(texcoords.end(), { u, 1.0f - v });
+		}
+		else if (type == "f")
+		{
+			face.clear();
+			std::string token;
+			while (stream >> token)
+			{
+				int64_t position, texcoord;
+				if (!ParseObjIndex(token, positions.size() / 3, texcoords.size() / 2, position, texcoord))
+				{
+					std::cout << "Invalid face in mesh " << fileName << ": " << line << std::endl;
+					return false;
+				}
+				uint64_t key = (static_cast<uint64_t>(position) << 32) | static_cast<uint32_t>(texcoord + 1);
+				auto found = vertexIndices.find(key);
+				if (found == vertexIndices.end())
+				{
+					MeshVertex vertex =
+					{
+						positions[position * 3 + 0],
+						positions[position * 3 + 1],
+						positions[position * 3 + 2],
+						1.0f,
+						texcoord >= 0 ? texcoords[texcoord * 2 + 0] : 0.0f,
+						texcoord >= 0 ? texcoords[texcoord * 2 + 1] : 0.0f,
+					};
+					found = vertexIndices.emplace(key, static_cast<uint32_t>(mesh.m_vertices.size())).first;
+					mesh.m_vertices.push_back(vertex);
+				}
+				face.push_back(found->second);
+			}
+			for (size_t i = 2; i < face.size(); ++i)
+			{
+				mesh.m_indices.insert(mesh.m_indices.end(), { face[0], face[i - 1], face[i] });
+			}
+		}
+	}
+	return !mesh.m_indices.empty();
+}
+
+float ComputeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+	// timestamps instead of a queue, a vertex is cached while fewer than cacheSize misses happened since it entered
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	uint32_t misses = 0;
+	for (uint32_t index : indices)
+	{
+		if (cachedAt[index] == 0 || misses - cachedAt[index] >= cacheSize)
+		{
+			++misses;
+			cachedAt[index] = misses;
+		}
+	}
+	return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+static const uint32_t forsyth_cache_size = 32;
+
+static float ForsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the last triangle's vertices score the same so no particular order within it is preferred
+		score = cachePosition < 3 ? 0.75f : std::pow(1.0f - (cachePosition - 3) / static_cast<float>(forsyth_cache_size - 3), 1.5f);
+	}
+	return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices)
+	{
+		++remaining[index];
+	}
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		firstTriangle[i + 1] = firstTriangle[i] + remaining[i];
+	}
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (uint32_t i = 0; i < indices.size(); ++i)
+	{
+		vertexTriangles[filled[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		vertexScore[i] = ForsythVertexScore(-1, remaining[i]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		triangleScore[i] = vertexScore[indices[i * 3]] + vertexScore[indices[i * 3 + 1]] + vertexScore[indices[i * 3 + 2]];
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	uint32_t bestTriangle = UINT32_MAX;
+	uint32_t scanCursor = 0;
+	while (result.size() < indices.size())
+	{
+		if (bestTriangle == UINT32_MAX)
+		{
+			// nothing in the cache touches unemitted triangles, continue with the next one in input order
+			while (emitted[scanCursor])
+			{
+				++scanCursor;
+			}
+			bestTriangle = scanCursor;
+		}
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		newCache.assign(triangle, triangle + 3);
+		for (uint32_t index : cache)
+		{
+			if (index != triangle[0] && index != triangle[1] && index != triangle[2])
+			{
+				newCache.push_back(index);
+			}
+		}
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			--remaining[triangle[i]];
+		}
+		for (uint32_t i = forsyth_cache_size; i < newCache.size(); ++i)
+		{
+			cachePosition[newCache[i]] = -1;
+			vertexScore[newCache[i]] = ForsythVertexScore(-1, remaining[newCache[i]]);
+		}
+		newCache.resize((std::min)(static_cast<uint32_t>(newCache.size()), forsyth_cache_size));
+		cache.swap(newCache);
+
+		for (uint32_t i = 0; i < cache.size(); ++i)
+		{
+			cachePosition[cache[i]] = static_cast<int32_t>(i);
+			vertexScore[cache[i]] = ForsythVertexScore(static_cast<int32_t>(i), remaining[cache[i]]);
+		}
+		float bestScore = -1.0f;
+		bestTriangle = UINT32_MAX;
+		for (uint32_t index : cache)
+		{
+			for (uint32_t i = firstTriangle[index]; i < firstTriangle[index + 1]; ++i)
+			{
+				uint32_t candidate = vertexTriangles[i];
+				if (emitted[candidate])
+				{
+					continue;
+				}
+				const uint32_t* vertices = &indices[candidate * 3];
+				triangleScore[candidate] = vertexScore[vertices[0]] + vertexScore[vertices[1]] + vertexScore[vertices[2]];
+				if (triangleScore[candidate] > bestScore)
+				{
+					bestScore = triangleScore[candidate];
+					bestTriangle = candidate;
+				}
+			}
+		}
+	}
+	indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, uint32_t cacheSize)
+{
+	// a triangle missing all three vertices starts a cluster, reordering whole clusters costs no extra misses
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	std::vector<uint32_t> clusterStarts;
+	std::vector<uint32_t> cachedAt(vertices.size(), 0);
+	uint32_t misses = 0;
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		uint32_t triangleMisses = 0;
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			uint32_t index = indices[i * 3 + j];
+			if (cachedAt[index] == 0 || misses - cachedAt[index] >= cacheSize)
+			{
+				++misses;
+				++triangleMisses;
+				cachedAt[index] = misses;
+			}
+		}
+		if (i == 0 || triangleMisses == 3)
+		{
+			clusterStarts.push_back(i);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	float meshCentroid[3] = {};
+	for (const MeshVertex& vertex : vertices)
+	{
+		meshCentroid[0] += vertex.x / vertices.size();
+		meshCentroid[1] += vertex.y / vertices.size();
+		meshCentroid[2] += vertex.z / vertices.size();
+	}
+	struct Cluster
+	{
+		uint32_t m_begin;
+		uint32_t m_end;
+		float m_sortKey;
+	};
+	std::vector<Cluster> clusters;
+	for (size_t c = 0; c + 1 < clusterStarts.size(); ++c)
+	{
+		float centroid[3] = {};
+		float normal[3] = {};
+		float area = 0.0f;
+		for (uint32_t i = clusterStarts[c]; i < clusterStarts[c + 1]; ++i)
+		{
+			const MeshVertex& a = vertices[indices[i * 3 + 0]];
+			const MeshVertex& b = vertices[indices[i * 3 + 1]];
+			const MeshVertex& d = vertices[indices[i * 3 + 2]];
+			float e0[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			float e1[3] = { d.x - a.x, d.y - a.y, d.z - a.z };
+			float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			centroid[0] += (a.x + b.x + d.x) / 3.0f * triangleArea;
+			centroid[1] += (a.y + b.y + d.y) / 3.0f * triangleArea;
+			centroid[2] += (a.z + b.z + d.z) / 3.0f * triangleArea;
+			normal[0] += n[0];
+			normal[1] += n[1];
+			normal[2] += n[2];
+			area += triangleArea;
+		}
+		float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float sortKey = 0.0f;
+		if (area > 0.0f && normalLength > 0.0f)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				sortKey += (centroid[k] / area - meshCentroid[k]) * normal[k] / normalLength;
+			}
+		}
+		clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], sortKey });
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.m_sortKey > b.m_sortKey; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const Cluster& cluster : clusters)
+	{
+		result.insert(result.end(), indices.begin() + cluster.m_begin * 3, indices.begin() + cluster.m_end * 3);
+	}
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	std::vector<uint32_t> remap(mesh.m_vertices.size(), UINT32_MAX);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.m_vertices.size());
+	for (uint32_t& index : mesh.m_indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.m_vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.m_vertices.swap(vertices);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct MeshVertex
+{
+	float x, y, z, w;
+	float u, v;
+};
+
+// indexed triangle lists
+struct MeshData
+{
+	std::vector<MeshVertex> m_vertices;
+	std::vector<uint32_t> m_indices;
+};
+
+// positions, texture coordinates and faces of a wavefront obj, polygons are fanned into triangles
+// and every distinct position / texture coordinate pair becomes one vertex. v is flipped so images
+// keep their top row at v = 0
+bool LoadObj(const char* fileName, MeshData& mesh);
+
+// average cache miss ratio, vertex shader runs per triangle through a fifo post-transform cache
+float ComputeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+// reorders triangles with Forsyth's linear speed vertex cache optimisation
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+// splits the triangles where the cache starts cold anyway and puts outward facing clusters first,
+// so front geometry tends to be drawn before what it hides without losing cache hits
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, uint32_t cacheSize = 16);
+
+// renumbers vertices in the order the indices first reach them
+void OptimizeVertexFetch(MeshData& mesh);
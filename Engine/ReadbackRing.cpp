@@ -0,0 +1,203 @@
+#include "ReadbackRing.h"
+#include "VulkanUtils.h"
+#include <fstream>
+#include <iostream>
+
+bool ReadbackRing::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, uint32_t slotCount, VkFormat format, VkExtent2D extent, RetireCallback retire)
+{
+	clear();
+	m_device = device;
+	m_memoryTracker = &memoryTracker;
+	m_retire = retire;
+	m_format = format;
+	m_extent = extent;
+	m_frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+	m_slots.resize(slotCount);
+	for (Slot& slot : m_slots)
+	{
+		// cached memory makes the host reads fast, it is usually not coherent so every read invalidates first
+		if (!CreateBuffer(device, physicalDevice, memoryTracker, m_frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, ReadbackMemory, slot.m_buffer, slot.m_deviceMemory, &slot.m_memoryFlags)
+			|| !MapMemory(device, slot.m_deviceMemory, slot.m_mappedData))
+		{
+			std::cout << "Could not create readback buffer!" << std::endl;
+			clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+void ReadbackRing::clear()
+{
+	for (Slot& slot : m_slots)
+	{
+		VkDevice device = m_device;
+		MemoryTracker* memoryTracker = m_memoryTracker;
+		VkBuffer buffer = slot.m_buffer;
+		VkDeviceMemory deviceMemory = slot.m_deviceMemory;
+		std::function<void()> deleter = [device, memoryTracker, buffer, deviceMemory]() {
+			vkDestroyBuffer(device, buffer, nullptr);
+			memoryTracker->free(device, deviceMemory);
+		};
+		if (m_retire)
+		{
+			m_retire(deleter);
+		}
+		else
+		{
+			deleter();
+		}
+	}
+	m_slots.clear();
+	m_head = 0;
+	m_pendingCount = 0;
+	m_frameSize = 0;
+}
+
+bool ReadbackRing::matches(VkFormat format, VkExtent2D extent) const
+{
+	return !m_slots.empty() && m_format == format && m_extent.width == extent.width && m_extent.height == extent.height;
+}
+
+uint32_t ReadbackRing::acquire(uint64_t frameNumber, uint64_t serial)
+{
+	if (m_pendingCount == m_slots.size())
+	{
+		++m_skippedFrames;
+		return UINT32_MAX;
+	}
+	uint32_t index = m_head;
+	m_head = (m_head + 1) % static_cast<uint32_t>(m_slots.size());
+	++m_pendingCount;
+	m_slots[index].m_frameNumber = frameNumber;
+	m_slots[index].m_serial = serial;
+	return index;
+}
+
+void ReadbackRing::release(uint32_t slot)
+{
+	uint32_t slotCount = static_cast<uint32_t>(m_slots.size());
+	if (0 == m_pendingCount || slot != (m_head + slotCount - 1) % slotCount)
+	{
+		return;
+	}
+	m_head = slot;
+	--m_pendingCount;
+}
+
+VkBuffer ReadbackRing::buffer(uint32_t slot) const
+{
+	return m_slots[slot].m_buffer;
+}
+
+VkDeviceSize ReadbackRing::frameSize() const
+{
+	return m_frameSize;
+}
+
+void ReadbackRing::copy(VkCommandBuffer commandBuffer, VkImage image, uint32_t slot) const
+{
+	VkBufferImageCopy bufferImageCopy =
+	{
+		0,
+		0,
+		0,
+		{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0,
+			0,
+			1,
+		},
+		{
+			0,
+			0,
+			0,
+		},
+		{
+			m_extent.width,
+			m_extent.height,
+			1,
+		},
+	};
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_slots[slot].m_buffer, 1, &bufferImageCopy);
+}
+
+uint32_t ReadbackRing::collect(uint64_t completedSerial, FrameCallback callback)
+{
+	// slots complete in the order they were acquired, the oldest pending one sits m_pendingCount behind the head
+	uint32_t collected = 0;
+	uint32_t slotCount = static_cast<uint32_t>(m_slots.size());
+	while (m_pendingCount > 0)
+	{
+		Slot& slot = m_slots[(m_head + slotCount - m_pendingCount) % slotCount];
+		if (slot.m_serial > completedSerial)
+		{
+			break;
+		}
+		InvalidateMemory(m_device, slot.m_deviceMemory, slot.m_memoryFlags);
+		ReadbackFrame frame;
+		frame.m_frameNumber = slot.m_frameNumber;
+		frame.m_format = m_format;
+		frame.m_extent = m_extent;
+		frame.m_data = static_cast<const uint8_t*>(slot.m_mappedData);
+		frame.m_size = m_frameSize;
+		if (callback)
+		{
+			callback(frame);
+		}
+		--m_pendingCount;
+		++m_readbackFrames;
+		++collected;
+	}
+	return collected;
+}
+
+uint64_t ReadbackRing::readbackFrames() const
+{
+	return m_readbackFrames;
+}
+
+uint64_t ReadbackRing::skippedFrames() const
+{
+	return m_skippedFrames;
+}
+
+bool WritePpm(const std::string& fileName, const ReadbackFrame& frame)
+{
+	bool bgra;
+	switch (frame.m_format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		bgra = false;
+		break;
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		bgra = true;
+		break;
+	default:
+		std::cout << "Could not write " << fileName << ", unsupported format " << frame.m_format << std::endl;
+		return false;
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not open " << fileName << std::endl;
+		return false;
+	}
+	file << "P6\n" << frame.m_extent.width << " " << frame.m_extent.height << "\n255\n";
+	std::vector<char> row(frame.m_extent.width * 3);
+	for (uint32_t y = 0; y < frame.m_extent.height; ++y)
+	{
+		const uint8_t* pixel = frame.m_data + static_cast<size_t>(y) * frame.m_extent.width * 4;
+		for (uint32_t x = 0; x < frame.m_extent.width; ++x, pixel += 4)
+		{
+			row[x * 3 + 0] = static_cast<char>(bgra ? pixel[2] : pixel[0]);
+			row[x * 3 + 1] = static_cast<char>(pixel[1]);
+			row[x * 3 + 2] = static_cast<char>(bgra ? pixel[0] : pixel[2]);
+		}
+		file.write(row.data(), row.size());
+	}
+	return static_cast<bool>(file);
+}
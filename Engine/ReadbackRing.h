@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MemoryTracker.h"
+
+struct ReadbackFrame
+{
+	uint64_t m_frameNumber{ 0 };
+	VkFormat m_format{ VK_FORMAT_UNDEFINED };
+	VkExtent2D m_extent{ 0, 0 };
+	const uint8_t* m_data{ nullptr };
+	VkDeviceSize m_size{ 0 };
+};
+
+// a ring of persistently mapped buffers in host visible, preferably host cached memory that
+// frames are copied into. a slot goes back to the host only once the serial of the frame that
+// filled it has completed, so pixels arrive a few frames late and nobody waits for the copy.
+// when every slot is still in flight the frame is skipped rather than stalling
+class ReadbackRing
+{
+public:
+	typedef std::function<void(const ReadbackFrame& frame)> FrameCallback;
+	typedef std::function<void(std::function<void()> deleter)> RetireCallback;
+
+	bool init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, uint32_t slotCount, VkFormat format, VkExtent2D extent, RetireCallback retire = nullptr);
+	void clear();
+	bool matches(VkFormat format, VkExtent2D extent) const;
+	uint32_t acquire(uint64_t frameNumber, uint64_t serial);
+	// gives back the slot acquired last, for a frame that ends up not being submitted
+	void release(uint32_t slot);
+	VkBuffer buffer(uint32_t slot) const;
+	VkDeviceSize frameSize() const;
+	void copy(VkCommandBuffer commandBuffer, VkImage image, uint32_t slot) const;
+	uint32_t collect(uint64_t completedSerial, FrameCallback callback);
+	uint64_t readbackFrames() const;
+	uint64_t skippedFrames() const;
+private:
+	struct Slot
+	{
+		VkBuffer m_buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+		VkMemoryPropertyFlags m_memoryFlags{ 0 };
+		void* m_mappedData{ nullptr };
+		uint64_t m_frameNumber{ 0 };
+		uint64_t m_serial{ 0 };
+	};
+	VkDevice m_device{ VK_NULL_HANDLE };
+	MemoryTracker* m_memoryTracker{ nullptr };
+	RetireCallback m_retire;
+	VkFormat m_format{ VK_FORMAT_UNDEFINED };
+	VkExtent2D m_extent{ 0, 0 };
+	VkDeviceSize m_frameSize{ 0 };
+	std::vector<Slot> m_slots;
+	uint32_t m_head{ 0 };
+	uint32_t m_pendingCount{ 0 };
+	uint64_t m_readbackFrames{ 0 };
+	uint64_t m_skippedFrames{ 0 };
+};
+
+// binary ppm of the rgb channels, 8 bit rgba and bgra formats only
+bool WritePpm(const std::string& fileName, const ReadbackFrame& frame);
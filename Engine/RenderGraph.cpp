@@ -0,0 +1,507 @@
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "VulkanUtils.h"
+#include <algorithm>
+
+struct UsageInfo
+{
+	VkPipelineStageFlags m_stages;
+	VkAccessFlags m_access;
+	VkImageLayout m_layout;
+};
+
+static const VkAccessFlags write_access_mask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static UsageInfo GetUsageInfo(RenderGraphUsage usage)
+{
+	switch (usage)
+	{
+	case UsageTransferSrc:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+	case UsageTransferDst:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+	case UsageVertexBuffer:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+	case UsageIndexBuffer:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+	case UsageUniformBuffer:
+		return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+	case UsageShaderRead:
+		return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	case UsageColorAttachment:
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	case UsageDepthAttachment:
+		return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	case UsagePresent:
+		return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	case UsageHostRead:
+		return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	default:
+		return { 0, 0, VK_IMAGE_LAYOUT_UNDEFINED };
+	}
+}
+
+static bool SameDesc(const RenderGraphImageDesc& a, const RenderGraphImageDesc& b)
+{
+	return a.m_format == b.m_format
+		&& a.m_extent.width == b.m_extent.width
+		&& a.m_extent.height == b.m_extent.height
+		&& a.m_usage == b.m_usage
+		&& a.m_samples == b.m_samples;
+}
+
+void RenderGraph::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, MemoryTracker* memoryTracker, RetireCallback retire)
+{
+	m_device = device;
+	m_physicalDevice = physicalDevice;
+	m_queueFamilyIndex = queueFamilyIndex;
+	m_memoryTracker = memoryTracker;
+	m_retire = retire;
+}
+
+void RenderGraph::setProfiler(GpuProfiler* profiler)
+{
+	m_profiler = profiler;
+}
+
+void RenderGraph::setSynchronization2(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2)
+{
+	m_barriers.setSynchronization2(cmdPipelineBarrier2);
+}
+
+void RenderGraph::clear()
+{
+	for (PhysicalImage& physicalImage : m_physicalImages)
+	{
+		retirePhysicalImage(physicalImage);
+	}
+	m_physicalImages.clear();
+	reset();
+}
+
+void RenderGraph::reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+}
+
+uint32_t RenderGraph::importImage(const char* name, VkImage image, VkFormat format, RenderGraphUsage initialUsage, RenderGraphUsage finalUsage, uint32_t finalQueueFamilyIndex)
+{
+	Resource resource = {};
+	resource.m_name = name;
+	resource.m_isImage = true;
+	resource.m_imported = true;
+	resource.m_image = image;
+	resource.m_format = format;
+	resource.m_initialUsage = initialUsage;
+	resource.m_finalUsage = finalUsage;
+	resource.m_finalQueueFamilyIndex = finalQueueFamilyIndex;
+	resource.m_physicalImage = UINT32_MAX;
+	m_resources.push_back(resource);
+	return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::importBuffer(const char* name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, RenderGraphUsage initialUsage, RenderGraphUsage finalUsage)
+{
+	Resource resource = {};
+	resource.m_name = name;
+	resource.m_isImage = false;
+	resource.m_imported = true;
+	resource.m_buffer = buffer;
+	resource.m_offset = offset;
+	resource.m_size = size;
+	resource.m_initialUsage = initialUsage;
+	resource.m_finalUsage = finalUsage;
+	resource.m_finalQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resource.m_physicalImage = UINT32_MAX;
+	m_resources.push_back(resource);
+	return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::createImage(const char* name, const RenderGraphImageDesc& desc)
+{
+	Resource resource = {};
+	resource.m_name = name;
+	resource.m_isImage = true;
+	resource.m_imported = false;
+	resource.m_format = desc.m_format;
+	resource.m_desc = desc;
+	resource.m_initialUsage = UsageNone;
+	resource.m_finalUsage = UsageNone;
+	resource.m_finalQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resource.m_physicalImage = UINT32_MAX;
+	m_resources.push_back(resource);
+	return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const char* name, ExecuteCallback execute)
+{
+	Pass pass;
+	pass.m_name = name;
+	pass.m_execute = execute;
+	pass.m_sideEffect = false;
+	pass.m_live = false;
+	m_passes.push_back(pass);
+	return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+	m_passes[pass].m_accesses.push_back({ resource, usage, false });
+}
+
+void RenderGraph::write(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+	m_passes[pass].m_accesses.push_back({ resource, usage, true });
+}
+
+void RenderGraph::setSideEffect(uint32_t pass)
+{
+	m_passes[pass].m_sideEffect = true;
+}
+
+bool RenderGraph::compile()
+{
+	// walking backwards a pass is live when it writes something imported or read by a live pass
+	std::vector<bool> needed(m_resources.size(), false);
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		needed[i] = m_resources[i].m_imported;
+	}
+	m_culledPassCount = 0;
+	for (uint32_t i = static_cast<uint32_t>(m_passes.size()); i-- > 0;)
+	{
+		Pass& pass = m_passes[i];
+		pass.m_live = pass.m_sideEffect;
+		for (const Access& access : pass.m_accesses)
+		{
+			pass.m_live = pass.m_live || (access.m_write && needed[access.m_resource]);
+		}
+		if (!pass.m_live)
+		{
+			++m_culledPassCount;
+			continue;
+		}
+		for (const Access& access : pass.m_accesses)
+		{
+			if (!access.m_write)
+			{
+				needed[access.m_resource] = true;
+			}
+		}
+	}
+
+	for (Resource& resource : m_resources)
+	{
+		resource.m_firstPass = UINT32_MAX;
+		resource.m_lastPass = 0;
+	}
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		if (!m_passes[i].m_live)
+		{
+			continue;
+		}
+		for (const Access& access : m_passes[i].m_accesses)
+		{
+			Resource& resource = m_resources[access.m_resource];
+			resource.m_firstPass = (std::min)(resource.m_firstPass, i);
+			resource.m_lastPass = (std::max)(resource.m_lastPass, i);
+		}
+	}
+
+	// transient images take the first physical image of the same description that is free again
+	std::vector<uint32_t> transients;
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		if (!m_resources[i].m_imported && m_resources[i].m_firstPass != UINT32_MAX)
+		{
+			transients.push_back(i);
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].m_firstPass < m_resources[b].m_firstPass; });
+	for (PhysicalImage& physicalImage : m_physicalImages)
+	{
+		physicalImage.m_used = false;
+	}
+	for (uint32_t index : transients)
+	{
+		Resource& resource = m_resources[index];
+		uint32_t physicalIndex = UINT32_MAX;
+		for (uint32_t i = 0; i < m_physicalImages.size() && physicalIndex == UINT32_MAX; ++i)
+		{
+			const PhysicalImage& physicalImage = m_physicalImages[i];
+			if (SameDesc(physicalImage.m_desc, resource.m_desc) && (!physicalImage.m_used || physicalImage.m_lastPass < resource.m_firstPass))
+			{
+				physicalIndex = i;
+			}
+		}
+		if (physicalIndex == UINT32_MAX)
+		{
+			PhysicalImage physicalImage;
+			physicalImage.m_desc = resource.m_desc;
+			if (!createPhysicalImage(physicalImage))
+			{
+				return false;
+			}
+			m_physicalImages.push_back(physicalImage);
+			physicalIndex = static_cast<uint32_t>(m_physicalImages.size() - 1);
+		}
+		PhysicalImage& physicalImage = m_physicalImages[physicalIndex];
+		physicalImage.m_used = true;
+		physicalImage.m_lastPass = resource.m_lastPass;
+		resource.m_physicalImage = physicalIndex;
+	}
+
+	// physical images nobody asked for this time belong to an old description, e.g. before a resize
+	std::vector<uint32_t> remap(m_physicalImages.size(), UINT32_MAX);
+	std::vector<PhysicalImage> physicalImages;
+	for (uint32_t i = 0; i < m_physicalImages.size(); ++i)
+	{
+		if (m_physicalImages[i].m_used)
+		{
+			remap[i] = static_cast<uint32_t>(physicalImages.size());
+			physicalImages.push_back(m_physicalImages[i]);
+		}
+		else
+		{
+			retirePhysicalImage(m_physicalImages[i]);
+		}
+	}
+	m_physicalImages.swap(physicalImages);
+	for (uint32_t index : transients)
+	{
+		Resource& resource = m_resources[index];
+		resource.m_physicalImage = remap[resource.m_physicalImage];
+		resource.m_image = m_physicalImages[resource.m_physicalImage].m_image;
+		resource.m_imageView = m_physicalImages[resource.m_physicalImage].m_imageView;
+	}
+	return true;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+	m_barrierCount = 0;
+	for (Resource& resource : m_resources)
+	{
+		if (!resource.m_imported)
+		{
+			continue;
+		}
+		UsageInfo info = GetUsageInfo(resource.m_initialUsage);
+		resource.m_state = State();
+		resource.m_state.m_layout = info.m_layout;
+		if (info.m_access & write_access_mask)
+		{
+			resource.m_state.m_writeStages = info.m_stages;
+			resource.m_state.m_writeAccess = info.m_access & write_access_mask;
+		}
+		else
+		{
+			resource.m_state.m_readStages = info.m_stages;
+		}
+	}
+
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		Pass& pass = m_passes[i];
+		if (!pass.m_live)
+		{
+			continue;
+		}
+		for (const Access& access : pass.m_accesses)
+		{
+			Resource& resource = m_resources[access.m_resource];
+			if (!resource.m_imported && resource.m_firstPass == i)
+			{
+				// the previous contents are discarded, only the ordering with earlier users remains
+				resource.m_state = m_physicalImages[resource.m_physicalImage].m_state;
+				resource.m_state.m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+		for (const Access& access : pass.m_accesses)
+		{
+			transition(m_resources[access.m_resource], access.m_usage, access.m_write, VK_QUEUE_FAMILY_IGNORED);
+		}
+
+		uint32_t scope = m_profiler ? m_profiler->beginScope(commandBuffer, pass.m_name) : UINT32_MAX;
+		m_barriers.flush(commandBuffer);
+		pass.m_execute(commandBuffer);
+		if (m_profiler)
+		{
+			m_profiler->endScope(commandBuffer, scope);
+		}
+
+		for (const Access& access : pass.m_accesses)
+		{
+			Resource& resource = m_resources[access.m_resource];
+			if (!resource.m_imported && resource.m_lastPass == i)
+			{
+				m_physicalImages[resource.m_physicalImage].m_state = resource.m_state;
+			}
+		}
+	}
+
+	for (Resource& resource : m_resources)
+	{
+		if (resource.m_imported && resource.m_finalUsage != UsageNone)
+		{
+			transition(resource, resource.m_finalUsage, false, resource.m_finalQueueFamilyIndex);
+		}
+	}
+	m_barriers.flush(commandBuffer);
+}
+
+VkImage RenderGraph::image(uint32_t resource) const
+{
+	return m_resources[resource].m_image;
+}
+
+VkImageView RenderGraph::imageView(uint32_t resource) const
+{
+	return m_resources[resource].m_imageView;
+}
+
+VkMemoryPropertyFlags RenderGraph::memoryFlags(uint32_t resource) const
+{
+	const Resource& transient = m_resources[resource];
+	return transient.m_physicalImage != UINT32_MAX ? m_physicalImages[transient.m_physicalImage].m_memoryFlags : 0;
+}
+
+uint32_t RenderGraph::culledPassCount() const
+{
+	return m_culledPassCount;
+}
+
+uint32_t RenderGraph::barrierCount() const
+{
+	return m_barrierCount;
+}
+
+void RenderGraph::transition(Resource& resource, RenderGraphUsage usage, bool write, uint32_t dstQueueFamilyIndex)
+{
+	UsageInfo info = GetUsageInfo(usage);
+	State& state = resource.m_state;
+	bool layoutChange = resource.m_isImage && info.m_layout != state.m_layout;
+	bool ownershipChange = dstQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED && dstQueueFamilyIndex != m_queueFamilyIndex;
+	// reads only wait for a write when it has not been made visible to their stage and access yet
+	bool hazard = state.m_writeAccess != 0 && (write || (info.m_stages & ~state.m_visibleStages) != 0 || (info.m_access & ~state.m_visibleAccess) != 0);
+	if (layoutChange || ownershipChange || hazard)
+	{
+		// with nothing to wait for the source is the destination stage itself, which also chains
+		// the transition after a semaphore wait on that stage such as the swapchain acquire
+		VkPipelineStageFlags srcStages = state.m_writeStages | state.m_readStages;
+		srcStages = srcStages != 0 ? srcStages : info.m_stages;
+		uint32_t srcQueueFamilyIndex = ownershipChange ? m_queueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+		uint32_t dstQueueFamily = ownershipChange ? dstQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+		if (resource.m_isImage)
+		{
+			m_barriers.addImage(resource.m_image, GetFormatAspect(resource.m_format), state.m_layout, info.m_layout, srcStages, state.m_writeAccess, info.m_stages, info.m_access, srcQueueFamilyIndex, dstQueueFamily);
+		}
+		else
+		{
+			m_barriers.addBuffer(resource.m_buffer, resource.m_offset, resource.m_size, srcStages, state.m_writeAccess, info.m_stages, info.m_access, srcQueueFamilyIndex, dstQueueFamily);
+		}
+		++m_barrierCount;
+		if (!write)
+		{
+			state.m_visibleStages |= info.m_stages;
+			state.m_visibleAccess |= info.m_access;
+		}
+	}
+	else if (write && state.m_readStages != 0)
+	{
+		// write after read only needs an execution dependency
+		m_barriers.addExecution(state.m_readStages, info.m_stages);
+	}
+
+	if (resource.m_isImage)
+	{
+		state.m_layout = info.m_layout;
+	}
+	if (write)
+	{
+		state.m_writeStages = info.m_stages;
+		state.m_writeAccess = info.m_access & write_access_mask;
+		state.m_readStages = 0;
+		state.m_visibleStages = 0;
+		state.m_visibleAccess = 0;
+	}
+	else
+	{
+		state.m_readStages |= info.m_stages;
+	}
+}
+
+bool RenderGraph::createPhysicalImage(PhysicalImage& physicalImage)
+{
+	if (m_memoryTracker == nullptr)
+	{
+		return false;
+	}
+	const RenderGraphImageDesc& desc = physicalImage.m_desc;
+	VkImageCreateInfo imageCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		nullptr,
+		0,
+		VK_IMAGE_TYPE_2D,
+		desc.m_format,
+		{
+			desc.m_extent.width,
+			desc.m_extent.height,
+			1,
+		},
+		1,
+		1,
+		desc.m_samples,
+		VK_IMAGE_TILING_OPTIMAL,
+		desc.m_usage,
+		VK_SHARING_MODE_EXCLUSIVE,
+		0,
+		nullptr,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	VkResult result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &physicalImage.m_image);
+	if (result != VK_SUCCESS)
+	{
+		physicalImage.m_image = VK_NULL_HANDLE;
+		return false;
+	}
+	// attachments that never leave the tile can live in lazily allocated memory where it exists
+	VkMemoryPropertyFlags preferredFlags = (desc.m_usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+	if (!AllocateImageMemory(m_device, m_physicalDevice, *m_memoryTracker, physicalImage.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferredFlags, RenderTargetMemory, physicalImage.m_deviceMemory, &physicalImage.m_memoryFlags)
+		|| !CreateImageView(m_device, physicalImage.m_image, desc.m_format, physicalImage.m_imageView))
+	{
+		retirePhysicalImage(physicalImage);
+		return false;
+	}
+	return true;
+}
+
+void RenderGraph::retirePhysicalImage(PhysicalImage& physicalImage)
+{
+	VkDevice device = m_device;
+	MemoryTracker* memoryTracker = m_memoryTracker;
+	PhysicalImage oldImage = physicalImage;
+	std::function<void()> deleter = [device, memoryTracker, oldImage]() {
+		vkDestroyImageView(device, oldImage.m_imageView, nullptr);
+		vkDestroyImage(device, oldImage.m_image, nullptr);
+		if (memoryTracker != nullptr)
+		{
+			memoryTracker->free(device, oldImage.m_deviceMemory);
+		}
+	};
+	if (m_retire)
+	{
+		m_retire(deleter);
+	}
+	else
+	{
+		deleter();
+	}
+	physicalImage.m_image = VK_NULL_HANDLE;
+	physicalImage.m_imageView = VK_NULL_HANDLE;
+	physicalImage.m_deviceMemory = VK_NULL_HANDLE;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+#include "MemoryTracker.h"
+#include "BarrierBatch.h"
+
+class GpuProfiler;
+
+enum RenderGraphUsage
+{
+	UsageNone,
+	UsageTransferSrc,
+	UsageTransferDst,
+	UsageVertexBuffer,
+	UsageIndexBuffer,
+	UsageUniformBuffer,
+	UsageShaderRead,
+	UsageColorAttachment,
+	UsageDepthAttachment,
+	UsagePresent,
+	UsageHostRead,
+};
+
+struct RenderGraphImageDesc
+{
+	VkFormat m_format{ VK_FORMAT_UNDEFINED };
+	VkExtent2D m_extent{ 0, 0 };
+	VkImageUsageFlags m_usage{ 0 };
+	VkSampleCountFlagBits m_samples{ VK_SAMPLE_COUNT_1_BIT };
+};
+
+// passes declare what they read and write, compile() culls passes whose results are never
+// used, places transient images and execute() records one batched barrier per pass followed
+// by the pass itself. imported resources start in their initial usage and are left in their
+// final usage, UsageNone keeps whatever state the last pass left. transient images are reused
+// by later passes of the same description once their last reader has run, they are discarded
+// between passes and frames. pass names must be string literals
+class RenderGraph
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer)> ExecuteCallback;
+	typedef std::function<void(std::function<void()> deleter)> RetireCallback;
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, MemoryTracker* memoryTracker = nullptr, RetireCallback retire = nullptr);
+	void setProfiler(GpuProfiler* profiler);
+	void setSynchronization2(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2);
+	void clear();
+	void reset();
+	uint32_t importImage(const char* name, VkImage image, VkFormat format, RenderGraphUsage initialUsage, RenderGraphUsage finalUsage, uint32_t finalQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+	uint32_t importBuffer(const char* name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, RenderGraphUsage initialUsage, RenderGraphUsage finalUsage);
+	uint32_t createImage(const char* name, const RenderGraphImageDesc& desc);
+	uint32_t addPass(const char* name, ExecuteCallback execute);
+	void read(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+	void write(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+	void setSideEffect(uint32_t pass);
+	bool compile();
+	void execute(VkCommandBuffer commandBuffer);
+	VkImage image(uint32_t resource) const;
+	VkImageView imageView(uint32_t resource) const;
+	VkMemoryPropertyFlags memoryFlags(uint32_t resource) const;
+	uint32_t culledPassCount() const;
+	uint32_t barrierCount() const;
+private:
+	struct State
+	{
+		VkImageLayout m_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags m_writeStages{ 0 };
+		VkAccessFlags m_writeAccess{ 0 };
+		VkPipelineStageFlags m_readStages{ 0 };
+		VkPipelineStageFlags m_visibleStages{ 0 };
+		VkAccessFlags m_visibleAccess{ 0 };
+	};
+	struct Resource
+	{
+		const char* m_name;
+		bool m_isImage;
+		bool m_imported;
+		VkImage m_image;
+		VkImageView m_imageView;
+		VkFormat m_format;
+		VkBuffer m_buffer;
+		VkDeviceSize m_offset;
+		VkDeviceSize m_size;
+		RenderGraphUsage m_initialUsage;
+		RenderGraphUsage m_finalUsage;
+		uint32_t m_finalQueueFamilyIndex;
+		RenderGraphImageDesc m_desc;
+		uint32_t m_physicalImage;
+		uint32_t m_firstPass;
+		uint32_t m_lastPass;
+		State m_state;
+	};
+	struct Access
+	{
+		uint32_t m_resource;
+		RenderGraphUsage m_usage;
+		bool m_write;
+	};
+	struct Pass
+	{
+		const char* m_name;
+		ExecuteCallback m_execute;
+		std::vector<Access> m_accesses;
+		bool m_sideEffect;
+		bool m_live;
+	};
+	struct PhysicalImage
+	{
+		RenderGraphImageDesc m_desc;
+		VkImage m_image{ VK_NULL_HANDLE };
+		VkImageView m_imageView{ VK_NULL_HANDLE };
+		VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+		VkMemoryPropertyFlags m_memoryFlags{ 0 };
+		State m_state;
+		uint32_t m_lastPass{ 0 };
+		bool m_used{ false };
+	};
+	void transition(Resource& resource, RenderGraphUsage usage, bool write, uint32_t dstQueueFamilyIndex);
+	bool createPhysicalImage(PhysicalImage& physicalImage);
+	void retirePhysicalImage(PhysicalImage& physicalImage);
+private:
+	VkDevice m_device{ VK_NULL_HANDLE };
+	VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+	uint32_t m_queueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED };
+	MemoryTracker* m_memoryTracker{ nullptr };
+	RetireCallback m_retire;
+	GpuProfiler* m_profiler{ nullptr };
+	BarrierBatch m_barriers;
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<PhysicalImage> m_physicalImages;
+	uint32_t m_culledPassCount{ 0 };
+	uint32_t m_barrierCount{ 0 };
+};
@@ -0,0 +1,86 @@
+#include "StreamBuffer.h"
+#include "VulkanUtils.h"
+#include <iostream>
+
+bool StreamBuffer::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkDeviceSize regionSize, uint32_t regionCount, VkBufferUsageFlags usage, RetireCallback retire)
+{
+	clear();
+	m_device = device;
+	m_memoryTracker = &memoryTracker;
+	m_retire = retire;
+	m_regionSize = regionSize;
+	if (!CreateBuffer(device, physicalDevice, memoryTracker, regionSize * regionCount, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VertexMemory, m_buffer, m_deviceMemory, &m_memoryFlags)
+		|| !MapMemory(device, m_deviceMemory, m_mappedData))
+	{
+		std::cout << "Could not create stream buffer!" << std::endl;
+		clear();
+		return false;
+	}
+	return true;
+}
+
+void StreamBuffer::clear()
+{
+	if (m_buffer != VK_NULL_HANDLE || m_deviceMemory != VK_NULL_HANDLE)
+	{
+		VkDevice device = m_device;
+		MemoryTracker* memoryTracker = m_memoryTracker;
+		VkBuffer buffer = m_buffer;
+		VkDeviceMemory deviceMemory = m_deviceMemory;
+		std::function<void()> deleter = [device, memoryTracker, buffer, deviceMemory]() {
+			vkDestroyBuffer(device, buffer, nullptr);
+			memoryTracker->free(device, deviceMemory);
+		};
+		if (m_retire)
+		{
+			m_retire(deleter);
+		}
+		else
+		{
+			deleter();
+		}
+	}
+	m_buffer = VK_NULL_HANDLE;
+	m_deviceMemory = VK_NULL_HANDLE;
+	m_mappedData = nullptr;
+	m_regionStart = 0;
+	m_offset = 0;
+}
+
+void StreamBuffer::beginFrame(uint32_t region)
+{
+	m_regionStart = m_regionSize * region;
+	m_offset = m_regionStart;
+}
+
+bool StreamBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment, void*& data, VkDeviceSize& offset)
+{
+	// alignments need not be powers of two, vertex strides are used to keep vertex offsets whole
+	VkDeviceSize alignedOffset = (m_offset + alignment - 1) / alignment * alignment;
+	if (m_mappedData == nullptr || alignedOffset + size > m_regionStart + m_regionSize)
+	{
+		return false;
+	}
+	data = static_cast<char*>(m_mappedData) + alignedOffset;
+	offset = alignedOffset;
+	m_offset = alignedOffset + size;
+	return true;
+}
+
+void StreamBuffer::endFrame()
+{
+	if (m_offset > m_regionStart)
+	{
+		FlushMemory(m_device, m_deviceMemory, m_memoryFlags);
+	}
+}
+
+VkBuffer StreamBuffer::buffer() const
+{
+	return m_buffer;
+}
+
+VkDeviceSize StreamBuffer::used() const
+{
+	return m_offset - m_regionStart;
+}
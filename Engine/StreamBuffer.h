@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include "MemoryTracker.h"
+
+// one persistently mapped buffer split into a region per frame in flight. every frame starts
+// a linear allocator at the beginning of its region, so nothing is freed and the cpu never
+// writes a region the gpu may still read. allocations that do not fit fail instead of wrapping
+class StreamBuffer
+{
+public:
+	typedef std::function<void(std::function<void()> deleter)> RetireCallback;
+
+	bool init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkDeviceSize regionSize, uint32_t regionCount, VkBufferUsageFlags usage, RetireCallback retire = nullptr);
+	void clear();
+	void beginFrame(uint32_t region);
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, void*& data, VkDeviceSize& offset);
+	void endFrame();
+	VkBuffer buffer() const;
+	VkDeviceSize used() const;
+private:
+	VkDevice m_device{ VK_NULL_HANDLE };
+	MemoryTracker* m_memoryTracker{ nullptr };
+	RetireCallback m_retire;
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+	VkMemoryPropertyFlags m_memoryFlags{ 0 };
+	void* m_mappedData{ nullptr };
+	VkDeviceSize m_regionSize{ 0 };
+	VkDeviceSize m_regionStart{ 0 };
+	VkDeviceSize m_offset{ 0 };
+};
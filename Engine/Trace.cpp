@@ -0,0 +1,123 @@
+#include "Trace.h"
+#include <chrono>
+#include <fstream>
+
+Tracer& Tracer::instance()
+{
+	static Tracer s_tracer;
+	return s_tracer;
+}
+
+Tracer::Tracer()
+{
+	m_events.resize(max_event_count);
+}
+
+int64_t Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t Tracer::currentThreadId()
+{
+	static std::atomic<uint32_t> s_nextThreadId{ 1 };
+	thread_local uint32_t t_threadId = s_nextThreadId.fetch_add(1);
+	return t_threadId;
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::enabled() const
+{
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(uint32_t threadId, const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& threadName : m_threadNames)
+	{
+		if (threadName.first == threadId)
+		{
+			threadName.second = name;
+			return;
+		}
+	}
+	m_threadNames.push_back(std::make_pair(threadId, std::string(name)));
+}
+
+void Tracer::addEvent(const char* name, uint32_t threadId, int64_t begin, int64_t duration)
+{
+	if (!enabled())
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TraceEvent& event = m_events[m_nextEvent];
+	event.m_name = name;
+	event.m_threadId = threadId;
+	event.m_begin = begin;
+	event.m_duration = duration;
+	m_nextEvent = (m_nextEvent + 1) % max_event_count;
+	m_wrapped = m_wrapped || 0 == m_nextEvent;
+}
+
+static void WriteJsonString(std::ofstream& file, const char* text)
+{
+	file << '"';
+	for (const char* c = text; *c != 0; ++c)
+	{
+		if ('"' == *c || '\\' == *c)
+		{
+			file << '\\';
+		}
+		file << *c;
+	}
+	file << '"';
+}
+
+bool Tracer::dump(const std::string& fileName)
+{
+	std::vector<TraceEvent> events;
+	std::vector<std::pair<uint32_t, std::string>> threadNames;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_wrapped)
+		{
+			events.insert(events.end(), m_events.begin() + m_nextEvent, m_events.end());
+		}
+		events.insert(events.end(), m_events.begin(), m_events.begin() + m_nextEvent);
+		threadNames = m_threadNames;
+	}
+
+	std::ofstream file(fileName);
+	if (file.fail())
+	{
+		return false;
+	}
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto& threadName : threadNames)
+	{
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first << ",\"args\":{\"name\":";
+		WriteJsonString(file, threadName.second.c_str());
+		file << "}}";
+		first = false;
+	}
+	for (const TraceEvent& event : events)
+	{
+		file << (first ? "" : ",\n") << "{\"name\":";
+		WriteJsonString(file, event.m_name);
+		file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.m_threadId
+			<< ",\"ts\":" << event.m_begin / 1000.0
+			<< ",\"dur\":" << event.m_duration / 1000.0 << "}";
+		first = false;
+	}
+	file << "\n]}\n";
+	return !file.fail();
+}
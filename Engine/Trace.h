@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent
+{
+	const char* m_name{ nullptr };
+	uint32_t m_threadId{ 0 };
+	int64_t m_begin{ 0 };
+	int64_t m_duration{ 0 };
+};
+
+// collects cpu and gpu zones in a ring buffer and writes them as chrome trace-event json,
+// timestamps are steady_clock nanoseconds and names must be string literals
+class Tracer
+{
+public:
+	static const uint32_t gpu_thread_id = 0xFFFF;
+
+	static Tracer& instance();
+	static int64_t now();
+	static uint32_t currentThreadId();
+
+	void setEnabled(bool enabled);
+	bool enabled() const;
+	void setThreadName(uint32_t threadId, const char* name);
+	void addEvent(const char* name, uint32_t threadId, int64_t begin, int64_t duration);
+	bool dump(const std::string& fileName);
+private:
+	Tracer();
+	static const size_t max_event_count = 1 << 18;
+	std::mutex m_mutex;
+	std::vector<TraceEvent> m_events;
+	size_t m_nextEvent{ 0 };
+	bool m_wrapped{ false };
+	std::vector<std::pair<uint32_t, std::string>> m_threadNames;
+	std::atomic<bool> m_enabled{ true };
+};
+
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name)
+		: m_name(name)
+		, m_begin(Tracer::instance().enabled() ? Tracer::now() : 0)
+	{
+	}
+	~TraceZone()
+	{
+		end();
+	}
+	void end()
+	{
+		if (m_begin != 0)
+		{
+			Tracer::instance().addEvent(m_name, Tracer::currentThreadId(), m_begin, Tracer::now() - m_begin);
+			m_begin = 0;
+		}
+	}
+private:
+	const char* m_name;
+	int64_t m_begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__FUNCTION__)
@@ -0,0 +1,203 @@
+#include "VertexLayout.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+struct VertexAttributeFormatInfo
+{
+	VkFormat m_format;
+	uint32_t m_componentCount;
+	uint32_t m_componentSize;
+};
+
+static const VertexAttributeFormatInfo vertex_attribute_formats[] =
+{
+	{ VK_FORMAT_R32G32B32A32_SFLOAT, 4, 4 },
+	{ VK_FORMAT_R32G32_SFLOAT, 2, 4 },
+	{ VK_FORMAT_R16G16B16A16_SFLOAT, 4, 2 },
+	{ VK_FORMAT_R16G16_SFLOAT, 2, 2 },
+	{ VK_FORMAT_R16G16B16A16_SNORM, 4, 2 },
+	{ VK_FORMAT_R16G16_UNORM, 2, 2 },
+	{ VK_FORMAT_R8G8B8A8_UNORM, 4, 1 },
+};
+
+VkFormat GetVertexAttributeFormat(VertexAttributeFormat format)
+{
+	return vertex_attribute_formats[format].m_format;
+}
+
+uint32_t GetVertexAttributeSize(VertexAttributeFormat format)
+{
+	return vertex_attribute_formats[format].m_componentCount * vertex_attribute_formats[format].m_componentSize;
+}
+
+uint16_t FloatToHalf(float value)
+{
+	// round to nearest even, overflow goes to infinity and underflow through the denormals to zero
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7fffff;
+	if (((bits >> 23) & 0xff) == 0xff)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	if (exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			++half;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+	// a mantissa carry rounds up into the exponent, the largest values into infinity
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		++half;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+VertexLayout& VertexLayout::add(uint32_t location, VertexAttributeFormat format, uint32_t binding)
+{
+	// every format is a multiple of four bytes so attributes stay aligned without padding
+	if (binding >= m_strides.size())
+	{
+		m_strides.resize(binding + 1, 0);
+	}
+	m_attributes.push_back({ location, format, binding, m_strides[binding] });
+	m_strides[binding] += GetVertexAttributeSize(format);
+	m_componentCount += vertex_attribute_formats[format].m_componentCount;
+	return *this;
+}
+
+uint32_t VertexLayout::bindingCount() const
+{
+	return static_cast<uint32_t>(m_strides.size());
+}
+
+uint32_t VertexLayout::stride(uint32_t binding) const
+{
+	return binding < m_strides.size() ? m_strides[binding] : 0;
+}
+
+uint32_t VertexLayout::vertexSize() const
+{
+	uint32_t size = 0;
+	for (uint32_t stride : m_strides)
+	{
+		size += stride;
+	}
+	return size;
+}
+
+uint32_t VertexLayout::componentCount() const
+{
+	return m_componentCount;
+}
+
+const std::vector<VertexAttribute>& VertexLayout::attributes() const
+{
+	return m_attributes;
+}
+
+std::vector<VkVertexInputBindingDescription> VertexLayout::bindingDescriptions() const
+{
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	for (uint32_t binding = 0; binding < m_strides.size(); ++binding)
+	{
+		VkVertexInputBindingDescription bindingDescription =
+		{
+			binding,
+			m_strides[binding],
+			VK_VERTEX_INPUT_RATE_VERTEX,
+		};
+		bindingDescriptions.push_back(bindingDescription);
+	}
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> VertexLayout::attributeDescriptions() const
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	for (const VertexAttribute& attribute : m_attributes)
+	{
+		VkVertexInputAttributeDescription attributeDescription =
+		{
+			attribute.m_location,
+			attribute.m_binding,
+			GetVertexAttributeFormat(attribute.m_format),
+			attribute.m_offset,
+		};
+		attributeDescriptions.push_back(attributeDescription);
+	}
+	return attributeDescriptions;
+}
+
+void VertexLayout::encode(const float* components, uint32_t vertexCount, uint32_t binding, void* data) const
+{
+	char* vertex = static_cast<char*>(data);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		for (const VertexAttribute& attribute : m_attributes)
+		{
+			const VertexAttributeFormatInfo& info = vertex_attribute_formats[attribute.m_format];
+			if (attribute.m_binding != binding)
+			{
+				components += info.m_componentCount;
+				continue;
+			}
+			char* destination = vertex + attribute.m_offset;
+			for (uint32_t c = 0; c < info.m_componentCount; ++c)
+			{
+				float value = *components++;
+				switch (attribute.m_format)
+				{
+				case AttributeFloat4:
+				case AttributeFloat2:
+					memcpy(destination + c * 4, &value, 4);
+					break;
+				case AttributeHalf4:
+				case AttributeHalf2:
+				{
+					uint16_t half = FloatToHalf(value);
+					memcpy(destination + c * 2, &half, 2);
+					break;
+				}
+				case AttributeSnorm16x4:
+				{
+					int16_t snorm = static_cast<int16_t>(std::lround((std::min)((std::max)(value, -1.0f), 1.0f) * 32767.0f));
+					memcpy(destination + c * 2, &snorm, 2);
+					break;
+				}
+				case AttributeUnorm16x2:
+				{
+					uint16_t unorm = static_cast<uint16_t>(std::lround((std::min)((std::max)(value, 0.0f), 1.0f) * 65535.0f));
+					memcpy(destination + c * 2, &unorm, 2);
+					break;
+				}
+				case AttributeUnorm8x4:
+					destination[c] = static_cast<char>(std::lround((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f));
+					break;
+				}
+			}
+		}
+		vertex += m_strides[binding];
+	}
+}
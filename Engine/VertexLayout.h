@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+enum VertexAttributeFormat
+{
+	AttributeFloat4,
+	AttributeFloat2,
+	AttributeHalf4,
+	AttributeHalf2,
+	AttributeSnorm16x4,
+	AttributeUnorm16x2,
+	AttributeUnorm8x4,
+};
+
+struct VertexAttribute
+{
+	uint32_t m_location;
+	VertexAttributeFormat m_format;
+	uint32_t m_binding;
+	uint32_t m_offset;
+};
+
+// attributes spread over one or more vertex buffer bindings, interleaved within a binding in the
+// order they are added. bindings are numbered from 0 without gaps, each one is a separate stream
+// so passes that only read some attributes only fetch their bindings. vertices are written as
+// floats, every attribute's components one after the other whatever their binding, and
+// converted to the attribute formats on the way. normalized formats clamp to their range
+class VertexLayout
+{
+public:
+	VertexLayout& add(uint32_t location, VertexAttributeFormat format, uint32_t binding = 0);
+	uint32_t bindingCount() const;
+	uint32_t stride(uint32_t binding) const;
+	// bytes of one vertex over all bindings
+	uint32_t vertexSize() const;
+	uint32_t componentCount() const;
+	const std::vector<VertexAttribute>& attributes() const;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions() const;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions() const;
+	// writes the attributes of one binding, data receives vertexCount * stride(binding) bytes
+	void encode(const float* components, uint32_t vertexCount, uint32_t binding, void* data) const;
+private:
+	std::vector<VertexAttribute> m_attributes;
+	std::vector<uint32_t> m_strides;
+	uint32_t m_componentCount{ 0 };
+};
+
+VkFormat GetVertexAttributeFormat(VertexAttributeFormat format);
+uint32_t GetVertexAttributeSize(VertexAttributeFormat format);
+uint16_t FloatToHalf(float value);
@@ -0,0 +1,975 @@
+#include "VulkanUtils.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+std::vector<char> GetBinaryFileContents(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (file.fail()) {
+		std::cout << "Could not open \"" << filename << "\" file!" << std::endl;
+		return std::vector<char>();
+	}
+
+	std::streampos begin, end;
+	begin = file.tellg();
+	file.seekg(0, std::ios::end);
+	end = file.tellg();
+
+	std::vector<char> result(static_cast<size_t>(end - begin));
+	if (result.empty())
+	{
+		return result;
+	}
+	file.seekg(0, std::ios::beg);
+	file.read(&result[0], end - begin);
+	file.close();
+
+	return result;
+}
+
+bool CheckExtensionAvailability(const char* desired, const std::vector<VkExtensionProperties>& availableExtensions)
+{
+	for (const VkExtensionProperties& extension : availableExtensions)
+	{
+		if (strcmp(desired, extension.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<VkExtensionProperties> GetInstanceExtensions()
+{
+	uint32_t extensionCount = 0;
+	VkResult result = vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	if (result != VK_SUCCESS || extensionCount == 0)
+	{
+		return std::vector<VkExtensionProperties>();
+	}
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	result = vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+	if (result != VK_SUCCESS)
+	{
+		return std::vector<VkExtensionProperties>();
+	}
+	return extensions;
+}
+
+std::vector<VkExtensionProperties> GetDeviceExtensions(VkPhysicalDevice physicalDevice)
+{
+	uint32_t extensionCount = 0;
+	VkResult result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	if (result != VK_SUCCESS || extensionCount == 0)
+	{
+		return std::vector<VkExtensionProperties>();
+	}
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+	if (result != VK_SUCCESS)
+	{
+		return std::vector<VkExtensionProperties>();
+	}
+	return extensions;
+}
+
+std::vector<const char*> GetSurfaceInstanceExtensions()
+{
+	return
+	{
+		VK_KHR_SURFACE_EXTENSION_NAME,
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+		VK_KHR_WIN32_SURFACE_EXTENSION_NAME
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+		VK_KHR_XCB_SURFACE_EXTENSION_NAME
+#elif defined(VK_USE_PLATFORM_XLIB_KHR)
+		VK_KHR_XLIB_SURFACE_EXTENSION_NAME
+#endif
+	};
+}
+
+bool CheckPhysicalDevice(uint32_t& graphicsQueueFamilyIndex, uint32_t& presentQueueFamilyIndex, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+{
+	std::vector<VkExtensionProperties> extensions = GetDeviceExtensions(physicalDevice);
+	if (surface != VK_NULL_HANDLE && !CheckExtensionAvailability(VK_KHR_SWAPCHAIN_EXTENSION_NAME, extensions))
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	if (VK_API_VERSION_MAJOR(physicalDeviceProperties.apiVersion) < 1)
+	{
+		return false;
+	}
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	if (0 == queueFamilyCount)
+	{
+		return false;
+	}
+
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	std::vector<VkBool32> queueFamilyPresentSupport(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		if (surface == VK_NULL_HANDLE)
+		{
+			queueFamilyPresentSupport[i] = VK_TRUE;
+			continue;
+		}
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &queueFamilyPresentSupport[i]);
+	}
+
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		if (queueFamilyProperties[i].queueCount > 0 &&
+			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT) &&
+			queueFamilyPresentSupport[i])
+		{
+			graphicsQueueFamilyIndex = i;
+			presentQueueFamilyIndex = i;
+			return true;
+		}
+	}
+
+	graphicsQueueFamilyIndex = UINT32_MAX;
+	presentQueueFamilyIndex = UINT32_MAX;
+
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		if (queueFamilyProperties[i].queueCount > 0 &&
+			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT))
+		{
+			graphicsQueueFamilyIndex = i;
+			break;
+		}
+	}
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		if (queueFamilyPresentSupport[i])
+		{
+			presentQueueFamilyIndex = i;
+			break;
+		}
+	}
+
+	return graphicsQueueFamilyIndex != UINT32_MAX && presentQueueFamilyIndex != UINT32_MAX;
+}
+
+bool CreateInstance(const char* applicationName, const std::vector<const char*>& extensions, VkInstance& instance)
+{
+	VkApplicationInfo applicationInfo =
+	{
+		VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		nullptr,
+		applicationName,
+		VK_MAKE_VERSION(1,0,0),
+		"VulkanTutorials",
+		VK_MAKE_VERSION(1,0,0),
+		VK_API_VERSION_1_0,
+	};
+
+	VkInstanceCreateInfo instanceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		nullptr,
+		0,
+		&applicationInfo,
+		0,
+		nullptr,
+		static_cast<uint32_t>(extensions.size()),
+		extensions.data()
+	};
+
+	VkResult result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+	if (result != VK_SUCCESS)
+	{
+		instance = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+bool CreateSurface(VkInstance instance, void* windowHandle, VkSurfaceKHR& surface)
+{
+	surface = VK_NULL_HANDLE;
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+	VkWin32SurfaceCreateInfoKHR surfaceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+		nullptr,
+		0,
+		GetModuleHandle(NULL),
+		(HWND)windowHandle,
+	};
+	VkResult result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
+	if (result != VK_SUCCESS)
+	{
+		surface = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+static bool HasFeatures(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& requiredFeatures)
+{
+	VkPhysicalDeviceFeatures availableFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &availableFeatures);
+	const VkBool32* required = reinterpret_cast<const VkBool32*>(&requiredFeatures);
+	const VkBool32* available = reinterpret_cast<const VkBool32*>(&availableFeatures);
+	for (size_t i = 0; i < sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32); ++i)
+	{
+		if (required[i] == VK_TRUE && available[i] != VK_TRUE)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool HasDedicatedTransferQueue(VkPhysicalDevice physicalDevice)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+	for (const VkQueueFamilyProperties& properties : queueFamilyProperties)
+	{
+		if (properties.queueCount > 0 &&
+			properties.queueFlags & VK_QUEUE_TRANSFER_BIT &&
+			0 == (properties.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static std::string FormatUuid(const uint8_t* uuid)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string text;
+	for (uint32_t i = 0; i < VK_UUID_SIZE; ++i)
+	{
+		if (i == 4 || i == 6 || i == 8 || i == 10)
+		{
+			text += '-';
+		}
+		text += digits[uuid[i] >> 4];
+		text += digits[uuid[i] & 0xf];
+	}
+	return text;
+}
+
+static std::string NormalizeDeviceKey(const std::string& text)
+{
+	std::string key;
+	for (char c : text)
+	{
+		if (c != '-' && c != ' ')
+		{
+			key += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		}
+	}
+	return key;
+}
+
+static uint64_t PhysicalDeviceTypeRank(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return 4;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return 3;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return 2;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+std::vector<PhysicalDeviceCandidate> RankPhysicalDevices(VkInstance instance, VkSurfaceKHR surface, const VkPhysicalDeviceFeatures* requiredFeatures, PFN_vkGetPhysicalDeviceProperties2KHR getProperties2)
+{
+	std::vector<PhysicalDeviceCandidate> candidates;
+	uint32_t physicalDeviceCount;
+	VkResult result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
+	{
+		return candidates;
+	}
+	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
+	result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
+	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
+	{
+		return candidates;
+	}
+
+	for (uint32_t i = 0; i < physicalDeviceCount; ++i)
+	{
+		PhysicalDeviceCandidate candidate;
+		candidate.m_physicalDevice = physicalDevices[i];
+		if (!CheckPhysicalDevice(candidate.m_graphicsQueueFamilyIndex, candidate.m_presentQueueFamilyIndex, physicalDevices[i], surface))
+		{
+			continue;
+		}
+		if (requiredFeatures != nullptr && !HasFeatures(physicalDevices[i], *requiredFeatures))
+		{
+			continue;
+		}
+
+		VkPhysicalDeviceProperties physicalDeviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevices[i], &physicalDeviceProperties);
+		candidate.m_name = physicalDeviceProperties.deviceName;
+		candidate.m_type = physicalDeviceProperties.deviceType;
+		if (getProperties2 != nullptr)
+		{
+			VkPhysicalDeviceIDPropertiesKHR idProperties = {};
+			idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES_KHR;
+			VkPhysicalDeviceProperties2KHR properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+			properties2.pNext = &idProperties;
+			getProperties2(physicalDevices[i], &properties2);
+			candidate.m_uuid = FormatUuid(idProperties.deviceUUID);
+		}
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevices[i], &memoryProperties);
+		for (uint32_t j = 0; j < memoryProperties.memoryHeapCount; ++j)
+		{
+			if (memoryProperties.memoryHeaps[j].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				candidate.m_deviceLocalMemory = (std::max)(candidate.m_deviceLocalMemory, memoryProperties.memoryHeaps[j].size);
+			}
+		}
+
+		const uint64_t heap_megabytes_limit = 1 << 20;
+		candidate.m_score = PhysicalDeviceTypeRank(candidate.m_type) << 40;
+		if (candidate.m_graphicsQueueFamilyIndex == candidate.m_presentQueueFamilyIndex)
+		{
+			candidate.m_score += 1ull << 36;
+		}
+		if (HasDedicatedTransferQueue(physicalDevices[i]))
+		{
+			candidate.m_score += 1ull << 32;
+		}
+		candidate.m_score += (std::min)(candidate.m_deviceLocalMemory >> 20, heap_megabytes_limit);
+		candidates.push_back(candidate);
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(), [](const PhysicalDeviceCandidate& a, const PhysicalDeviceCandidate& b) {
+		return a.m_score > b.m_score;
+	});
+
+	const char* deviceOverride = std::getenv(physical_device_override_variable);
+	if (deviceOverride != nullptr && deviceOverride[0] != 0)
+	{
+		std::string key = NormalizeDeviceKey(deviceOverride);
+		auto it = std::find_if(candidates.begin(), candidates.end(), [&key](const PhysicalDeviceCandidate& candidate) {
+			return (!candidate.m_uuid.empty() && NormalizeDeviceKey(candidate.m_uuid) == key)
+				|| NormalizeDeviceKey(candidate.m_name).find(key) != std::string::npos;
+		});
+		if (it != candidates.end())
+		{
+			std::rotate(candidates.begin(), it, it + 1);
+		}
+		else
+		{
+			std::cout << physical_device_override_variable << "=\"" << deviceOverride << "\" matches no device, using the highest scored one" << std::endl;
+		}
+	}
+	return candidates;
+}
+
+bool SelectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, PhysicalDeviceCandidate& candidate, const VkPhysicalDeviceFeatures* requiredFeatures, PFN_vkGetPhysicalDeviceProperties2KHR getProperties2)
+{
+	std::vector<PhysicalDeviceCandidate> candidates = RankPhysicalDevices(instance, surface, requiredFeatures, getProperties2);
+	if (candidates.empty())
+	{
+		return false;
+	}
+	candidate = candidates[0];
+	return true;
+}
+
+bool CreateDevice(const PhysicalDeviceCandidate& candidate, const std::vector<const char*>& extensions, const VkPhysicalDeviceFeatures* features, const void* next, VkDevice& device, VkQueue& graphicsQueue, VkQueue& presentQueue)
+{
+	bool separateGraphicsPresentQueue = candidate.m_graphicsQueueFamilyIndex != candidate.m_presentQueueFamilyIndex;
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo deviceQueueCreateInfo[2] =
+	{
+		{
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			nullptr,
+			0,
+			candidate.m_graphicsQueueFamilyIndex,
+			1,
+			&queuePriority
+		},
+		{
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			nullptr,
+			0,
+			candidate.m_presentQueueFamilyIndex,
+			1,
+			&queuePriority
+		},
+	};
+
+	VkDeviceCreateInfo deviceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		next,
+		0,
+		separateGraphicsPresentQueue ? 2u : 1u,
+		deviceQueueCreateInfo,
+		0,
+		nullptr,
+		static_cast<uint32_t>(extensions.size()),
+		extensions.data(),
+		features
+	};
+
+	VkResult result = vkCreateDevice(candidate.m_physicalDevice, &deviceCreateInfo, nullptr, &device);
+	if (result != VK_SUCCESS)
+	{
+		device = VK_NULL_HANDLE;
+		return false;
+	}
+	vkGetDeviceQueue(device, candidate.m_graphicsQueueFamilyIndex, 0, &graphicsQueue);
+	vkGetDeviceQueue(device, candidate.m_presentQueueFamilyIndex, 0, &presentQueue);
+	return true;
+}
+
+VkShaderModule CreateShaderModule(VkDevice device, const char* fileName)
+{
+	std::vector<char> shaderCode = GetBinaryFileContents(fileName);
+	if (shaderCode.empty())
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	VkShaderModuleCreateInfo shaderModuleCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		nullptr,
+		0,
+		shaderCode.size(),
+		(const uint32_t*)shaderCode.data(),
+	};
+
+	VkShaderModule shaderModule;
+	VkResult result = vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		return VK_NULL_HANDLE;
+	}
+	return shaderModule;
+}
+
+bool CreateSwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, uint32_t desiredImageCount, VkSwapchainKHR oldSwapChain, SwapChainDesc& swapChain)
+{
+	VkResult result;
+	swapChain.m_swapChain = VK_NULL_HANDLE;
+	swapChain.m_images.clear();
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+	result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	if (0 == (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+	{
+		return false;
+	}
+	uint32_t formatCount;
+	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, nullptr);
+	if (result != VK_SUCCESS || formatCount == 0)
+	{
+		return false;
+	}
+	std::vector<VkSurfaceFormatKHR> formats(formatCount);
+	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, formats.data());
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	uint32_t presentModeCount;
+	result = vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+	if (result != VK_SUCCESS || presentModeCount == 0)
+	{
+		return false;
+	}
+	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+	result = vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	if (surfaceCapabilities.maxImageCount > 0)
+	{
+		desiredImageCount = (std::min)(desiredImageCount, surfaceCapabilities.maxImageCount);
+	}
+	desiredImageCount = (std::max)(desiredImageCount, surfaceCapabilities.minImageCount);
+
+	VkSurfaceFormatKHR desiredFormat = formats[0];
+	for (VkSurfaceFormatKHR &format : formats)
+	{
+		if (format.format == VK_FORMAT_R8G8B8A8_UNORM)
+		{
+			desiredFormat = format;
+			break;
+		}
+	}
+	if (desiredFormat.format == VK_FORMAT_UNDEFINED)
+	{
+		desiredFormat.format = VK_FORMAT_R8G8B8A8_UNORM;
+		desiredFormat.colorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
+	}
+	VkExtent2D desiredExtent = surfaceCapabilities.currentExtent;
+	desiredExtent.width = (std::min)(desiredExtent.width, surfaceCapabilities.maxImageExtent.width);
+	desiredExtent.width = (std::max)(desiredExtent.width, surfaceCapabilities.minImageExtent.width);
+	desiredExtent.height = (std::min)(desiredExtent.height, surfaceCapabilities.maxImageExtent.height);
+	desiredExtent.height = (std::max)(desiredExtent.height, surfaceCapabilities.minImageExtent.height);
+	if (0 == desiredExtent.width || 0 == desiredExtent.height)
+	{
+		return true;
+	}
+
+	VkImageUsageFlags desiredUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	VkSurfaceTransformFlagBitsKHR desiredTransform = surfaceCapabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR : surfaceCapabilities.currentTransform;
+
+	VkPresentModeKHR desiredPresentMode = presentModes[0];
+	for (VkPresentModeKHR presentMode : presentModes)
+	{
+		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		{
+			desiredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			break;
+		}
+		else if (presentMode == VK_PRESENT_MODE_FIFO_KHR)
+		{
+			desiredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+		}
+	}
+
+	VkSwapchainCreateInfoKHR swapChainCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		nullptr,
+		0,
+		surface,
+		desiredImageCount,
+		desiredFormat.format,
+		desiredFormat.colorSpace,
+		desiredExtent,
+		1,
+		desiredUsage,
+		VK_SHARING_MODE_EXCLUSIVE,
+		0,
+		nullptr,
+		desiredTransform,
+		VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		desiredPresentMode,
+		VK_TRUE,
+		oldSwapChain,
+	};
+
+	result = vkCreateSwapchainKHR(device, &swapChainCreateInfo, nullptr, &swapChain.m_swapChain);
+	if (result != VK_SUCCESS)
+	{
+		swapChain.m_swapChain = VK_NULL_HANDLE;
+		return false;
+	}
+	swapChain.m_format = desiredFormat.format;
+	swapChain.m_extent = desiredExtent;
+
+	uint32_t imageCount = 0;
+	result = vkGetSwapchainImagesKHR(device, swapChain.m_swapChain, &imageCount, nullptr);
+	if (result != VK_SUCCESS || imageCount == 0)
+	{
+		return false;
+	}
+	std::vector<VkImage> images(imageCount);
+	result = vkGetSwapchainImagesKHR(device, swapChain.m_swapChain, &imageCount, images.data());
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	swapChain.m_images.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; ++i)
+	{
+		swapChain.m_images[i].m_image = images[i];
+		if (!CreateImageView(device, images[i], swapChain.m_format, swapChain.m_images[i].m_imageView))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+VkImageAspectFlags GetFormatAspect(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+VkSampleCountFlagBits SelectSampleCount(VkPhysicalDevice physicalDevice, uint32_t requested)
+{
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	VkSampleCountFlags supported = physicalDeviceProperties.limits.framebufferColorSampleCounts;
+	uint32_t sampleCount = VK_SAMPLE_COUNT_64_BIT;
+	while (sampleCount > VK_SAMPLE_COUNT_1_BIT && (sampleCount > requested || 0 == (supported & sampleCount)))
+	{
+		sampleCount >>= 1;
+	}
+	return static_cast<VkSampleCountFlagBits>(sampleCount);
+}
+
+VkFormat SelectDepthFormat(VkPhysicalDevice physicalDevice)
+{
+	static const VkFormat depth_formats[] =
+	{
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D16_UNORM,
+	};
+	for (VkFormat format : depth_formats)
+	{
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+		if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			return format;
+		}
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+bool CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageView& imageView)
+{
+	VkImageViewCreateInfo imageViewCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		nullptr,
+		0,
+		image,
+		VK_IMAGE_VIEW_TYPE_2D,
+		format,
+		{
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+			VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		{
+			GetFormatAspect(format),
+			0,
+			1,
+			0,
+			1,
+		},
+	};
+	VkResult result = vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageView);
+	if (result != VK_SUCCESS)
+	{
+		imageView = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+bool CreateRenderingResources(VkDevice device, VkCommandPool commandPool, std::vector<RenderingResource>& renderingResources)
+{
+	std::vector<VkCommandBuffer> commandBuffers(renderingResources.size());
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo =
+	{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		nullptr,
+		commandPool,
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		static_cast<uint32_t>(commandBuffers.size()),
+	};
+	VkResult result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffers.data());
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		nullptr,
+		0
+	};
+	VkFenceCreateInfo fenceCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		nullptr,
+		VK_FENCE_CREATE_SIGNALED_BIT
+	};
+	for (size_t i = 0; i < renderingResources.size(); ++i)
+	{
+		RenderingResource& renderingResource = renderingResources[i];
+		renderingResource.m_commandBuffer = commandBuffers[i];
+		if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderingResource.m_imageAvailableSemaphore) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderingResource.m_renderingFinishedSemaphore) != VK_SUCCESS ||
+			vkCreateFence(device, &fenceCreateInfo, nullptr, &renderingResource.m_fence) != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DestroyRenderingResources(VkDevice device, VkCommandPool commandPool, std::vector<RenderingResource>& renderingResources)
+{
+	for (RenderingResource& renderingResource : renderingResources)
+	{
+		if (renderingResource.m_commandBuffer != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(device, commandPool, 1, &renderingResource.m_commandBuffer);
+		}
+		vkDestroyFramebuffer(device, renderingResource.m_framebuffer, nullptr);
+		vkDestroySemaphore(device, renderingResource.m_imageAvailableSemaphore, nullptr);
+		vkDestroySemaphore(device, renderingResource.m_renderingFinishedSemaphore, nullptr);
+		vkDestroyFence(device, renderingResource.m_fence, nullptr);
+	}
+	renderingResources.clear();
+}
+
+static uint32_t CountBits(VkMemoryPropertyFlags flags)
+{
+	uint32_t count = 0;
+	for (; flags; flags &= flags - 1)
+	{
+		++count;
+	}
+	return count;
+}
+
+std::vector<uint32_t> RankMemoryTypes(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags)
+{
+	std::vector<uint32_t> memoryTypes;
+	std::vector<uint32_t> scores;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		VkMemoryPropertyFlags propertyFlags = memoryProperties.memoryTypes[i].propertyFlags;
+		if (!(memoryTypeBits & 1 << i) || (propertyFlags & requiredFlags) != requiredFlags)
+		{
+			continue;
+		}
+		// every preferred flag outweighs all unrequested ones, which are only a tie breaker
+		uint32_t matched = CountBits(propertyFlags & preferredFlags);
+		uint32_t unrequested = CountBits(propertyFlags & ~(requiredFlags | preferredFlags));
+		memoryTypes.push_back(i);
+		scores.push_back(matched * 32 + (31 - (std::min)(unrequested, 31u)));
+	}
+	std::vector<uint32_t> order(memoryTypes.size());
+	for (uint32_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&scores](uint32_t a, uint32_t b) { return scores[a] > scores[b]; });
+	std::vector<uint32_t> rankedMemoryTypes;
+	for (uint32_t index : order)
+	{
+		rankedMemoryTypes.push_back(memoryTypes[index]);
+	}
+	return rankedMemoryTypes;
+}
+
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	std::vector<uint32_t> memoryTypes = RankMemoryTypes(memoryProperties, memoryTypeBits, requiredFlags, preferredFlags);
+	return memoryTypes.empty() ? UINT32_MAX : memoryTypes[0];
+}
+
+static bool AllocateMemory(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, MemoryCategory category, VkDeviceMemory& deviceMemory, VkMemoryPropertyFlags* memoryFlags)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	std::vector<uint32_t> memoryTypes = RankMemoryTypes(memoryProperties, memoryRequirements.memoryTypeBits, requiredFlags, preferredFlags);
+
+	// types whose heap has no budget left go last, small heaps like the 256MB BAR window fill up first
+	const std::vector<MemoryHeapUsage>& heaps = memoryTracker.heaps();
+	std::stable_partition(memoryTypes.begin(), memoryTypes.end(), [&](uint32_t memoryType)
+	{
+		uint32_t heapIndex = memoryProperties.memoryTypes[memoryType].heapIndex;
+		if (heapIndex >= heaps.size())
+		{
+			return true;
+		}
+		const MemoryHeapUsage& heap = heaps[heapIndex];
+		return heap.m_usage + memoryRequirements.size <= heap.m_budget;
+	});
+
+	deviceMemory = VK_NULL_HANDLE;
+	for (uint32_t memoryType : memoryTypes)
+	{
+		VkMemoryAllocateInfo allocateInfo =
+		{
+			VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			nullptr,
+			memoryRequirements.size,
+			memoryType
+		};
+		if (memoryTracker.allocate(device, allocateInfo, category, &deviceMemory) == VK_SUCCESS)
+		{
+			if (memoryFlags)
+			{
+				*memoryFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+			}
+			return true;
+		}
+		deviceMemory = VK_NULL_HANDLE;
+	}
+	return false;
+}
+
+bool CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& deviceMemory, VkMemoryPropertyFlags* memoryFlags)
+{
+	VkBufferCreateInfo bufferCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		nullptr,
+		0,
+		size,
+		usage,
+		VK_SHARING_MODE_EXCLUSIVE,
+		0,
+		nullptr,
+	};
+	VkResult result = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+	if (result != VK_SUCCESS)
+	{
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+	if (!AllocateMemory(device, physicalDevice, memoryTracker, memoryRequirements, requiredFlags, preferredFlags, category, deviceMemory, memoryFlags))
+	{
+		return false;
+	}
+	result = vkBindBufferMemory(device, buffer, deviceMemory, 0);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool AllocateImageMemory(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkImage image, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, MemoryCategory category, VkDeviceMemory& deviceMemory, VkMemoryPropertyFlags* memoryFlags)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+	if (!AllocateMemory(device, physicalDevice, memoryTracker, memoryRequirements, requiredFlags, preferredFlags, category, deviceMemory, memoryFlags))
+	{
+		return false;
+	}
+	VkResult result = vkBindImageMemory(device, image, deviceMemory, 0);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool WriteMemory(VkDevice device, VkDeviceMemory deviceMemory, const void* data, VkDeviceSize size)
+{
+	void* mappedPtr;
+	VkResult result = vkMapMemory(device, deviceMemory, 0, size, 0, &mappedPtr);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	memcpy(mappedPtr, data, static_cast<size_t>(size));
+	VkMappedMemoryRange mappedMemoryRange =
+	{
+		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		nullptr,
+		deviceMemory,
+		0,
+		VK_WHOLE_SIZE,
+	};
+	vkFlushMappedMemoryRanges(device, 1, &mappedMemoryRange);
+	vkUnmapMemory(device, deviceMemory);
+	return true;
+}
+
+bool MapMemory(VkDevice device, VkDeviceMemory deviceMemory, void*& mappedData)
+{
+	VkResult result = vkMapMemory(device, deviceMemory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+	if (result != VK_SUCCESS)
+	{
+		mappedData = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void FlushMemory(VkDevice device, VkDeviceMemory deviceMemory, VkMemoryPropertyFlags memoryFlags)
+{
+	if (memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+	{
+		return;
+	}
+	VkMappedMemoryRange mappedMemoryRange =
+	{
+		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		nullptr,
+		deviceMemory,
+		0,
+		VK_WHOLE_SIZE,
+	};
+	vkFlushMappedMemoryRanges(device, 1, &mappedMemoryRange);
+}
+
+void InvalidateMemory(VkDevice device, VkDeviceMemory deviceMemory, VkMemoryPropertyFlags memoryFlags)
+{
+	if (memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+	{
+		return;
+	}
+	VkMappedMemoryRange mappedMemoryRange =
+	{
+		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+		nullptr,
+		deviceMemory,
+		0,
+		VK_WHOLE_SIZE,
+	};
+	vkInvalidateMappedMemoryRanges(device, 1, &mappedMemoryRange);
+}
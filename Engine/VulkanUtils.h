@@ -0,0 +1,103 @@
+#pragma once
+
+#if defined(_WIN32) && !defined(VK_USE_PLATFORM_WIN32_KHR)
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include "MemoryTracker.h"
+
+struct SwapchainImage
+{
+	VkImage m_image{ VK_NULL_HANDLE };
+	VkImageView m_imageView{ VK_NULL_HANDLE };
+	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+};
+
+struct VertexBuffer
+{
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+	uint32_t m_size{ 0 };
+	VkMemoryPropertyFlags m_memoryFlags{ 0 };
+	void* m_mappedData{ nullptr };
+};
+
+struct RenderingResource
+{
+	VkFramebuffer m_framebuffer{ VK_NULL_HANDLE };
+	VkCommandBuffer m_commandBuffer{ VK_NULL_HANDLE };
+	VkSemaphore m_imageAvailableSemaphore{ VK_NULL_HANDLE };
+	VkSemaphore m_renderingFinishedSemaphore{ VK_NULL_HANDLE };
+	VkFence m_fence{ VK_NULL_HANDLE };
+	uint64_t m_serial{ 0 };
+};
+
+struct PhysicalDeviceCandidate
+{
+	VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+	uint32_t m_graphicsQueueFamilyIndex{ UINT32_MAX };
+	uint32_t m_presentQueueFamilyIndex{ UINT32_MAX };
+	std::string m_name;
+	std::string m_uuid;
+	VkPhysicalDeviceType m_type{ VK_PHYSICAL_DEVICE_TYPE_OTHER };
+	VkDeviceSize m_deviceLocalMemory{ 0 };
+	uint64_t m_score{ 0 };
+};
+
+// name substring or device uuid of the device to use instead of the highest scored one
+static const char* const physical_device_override_variable = "VK_TUTORIAL_DEVICE";
+
+struct SwapChainDesc
+{
+	VkSwapchainKHR m_swapChain{ VK_NULL_HANDLE };
+	VkFormat m_format{ VK_FORMAT_UNDEFINED };
+	VkExtent2D m_extent{ 0, 0 };
+	std::vector<SwapchainImage> m_images;
+};
+
+std::vector<char> GetBinaryFileContents(const char* filename);
+bool CheckExtensionAvailability(const char* desired, const std::vector<VkExtensionProperties>& availableExtensions);
+std::vector<VkExtensionProperties> GetInstanceExtensions();
+std::vector<VkExtensionProperties> GetDeviceExtensions(VkPhysicalDevice physicalDevice);
+std::vector<const char*> GetSurfaceInstanceExtensions();
+bool CheckPhysicalDevice(uint32_t& graphicsQueueFamilyIndex, uint32_t& presentQueueFamilyIndex, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+
+// device setup shared by every renderer, a null surface selects headless devices
+bool CreateInstance(const char* applicationName, const std::vector<const char*>& extensions, VkInstance& instance);
+bool CreateSurface(VkInstance instance, void* windowHandle, VkSurfaceKHR& surface);
+
+// candidates are ranked by device type, then a shared graphics/present queue and a dedicated
+// transfer queue, then device local heap size. the uuid needs VK_KHR_get_physical_device_properties2
+std::vector<PhysicalDeviceCandidate> RankPhysicalDevices(VkInstance instance, VkSurfaceKHR surface, const VkPhysicalDeviceFeatures* requiredFeatures = nullptr, PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 = nullptr);
+bool SelectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, PhysicalDeviceCandidate& candidate, const VkPhysicalDeviceFeatures* requiredFeatures = nullptr, PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 = nullptr);
+
+bool CreateDevice(const PhysicalDeviceCandidate& candidate, const std::vector<const char*>& extensions, const VkPhysicalDeviceFeatures* features, const void* next, VkDevice& device, VkQueue& graphicsQueue, VkQueue& presentQueue);
+VkShaderModule CreateShaderModule(VkDevice device, const char* fileName);
+
+// creates a new swapchain, leaves swapChain null when the surface has zero extent; the caller owns oldSwapChain
+bool CreateSwapChain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, uint32_t desiredImageCount, VkSwapchainKHR oldSwapChain, SwapChainDesc& swapChain);
+VkImageAspectFlags GetFormatAspect(VkFormat format);
+// the highest sample count not above requested that color attachments support, at least one
+VkSampleCountFlagBits SelectSampleCount(VkPhysicalDevice physicalDevice, uint32_t requested);
+// the most precise depth only format usable as an optimal tiling attachment, undefined when there is none
+VkFormat SelectDepthFormat(VkPhysicalDevice physicalDevice);
+bool CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageView& imageView);
+
+bool CreateRenderingResources(VkDevice device, VkCommandPool commandPool, std::vector<RenderingResource>& renderingResources);
+void DestroyRenderingResources(VkDevice device, VkCommandPool commandPool, std::vector<RenderingResource>& renderingResources);
+
+// memory types must have every required flag and are ranked by preferred flags matched, then by
+// fewest flags nobody asked for. allocation falls back down the ranking when a heap is over budget
+// or the allocation fails, memoryFlags receives the flags of the type actually used
+std::vector<uint32_t> RankMemoryTypes(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags);
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags);
+bool CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& deviceMemory, VkMemoryPropertyFlags* memoryFlags = nullptr);
+bool AllocateImageMemory(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker& memoryTracker, VkImage image, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags, MemoryCategory category, VkDeviceMemory& deviceMemory, VkMemoryPropertyFlags* memoryFlags = nullptr);
+bool WriteMemory(VkDevice device, VkDeviceMemory deviceMemory, const void* data, VkDeviceSize size);
+// persistent mappings stay valid until the memory is freed, non coherent memory needs a flush after writing
+// and an invalidate before reading what the device wrote
+bool MapMemory(VkDevice device, VkDeviceMemory deviceMemory, void*& mappedData);
+void FlushMemory(VkDevice device, VkDeviceMemory deviceMemory, VkMemoryPropertyFlags memoryFlags);
+void InvalidateMemory(VkDevice device, VkDeviceMemory deviceMemory, VkMemoryPropertyFlags memoryFlags);
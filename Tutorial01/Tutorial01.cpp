@@ -4,140 +4,6 @@
 #include <QAbstractEventDispatcher>
 #include <QDebug>
 #include <vector>
-#include <fstream>
-#include <iostream>
-
-std::vector<char> GetBinaryFileContents(char const* filename) {
-
-	std::ifstream file(filename, std::ios::binary);
-	if (file.fail()) {
-		std::cout << "Could not open \"" << filename << "\" file!" << std::endl;
-		return std::vector<char>();
-	}
-
-	std::streampos begin, end;
-	begin = file.tellg();
-	file.seekg(0, std::ios::end);
-	end = file.tellg();
-
-	std::vector<char> result(static_cast<size_t>(end - begin));
-	file.seekg(0, std::ios::beg);
-	file.read(&result[0], end - begin);
-	file.close();
-
-	return result;
-}
-
-bool CheckExtensionAvailability(const char* desired, std::vector<VkExtensionProperties>& availableExtensions)
-{
-	for (VkExtensionProperties& extension : availableExtensions)
-	{
-		if (strcmp(desired, extension.extensionName) == 0)
-		{
-			return true;
-		}
-	}
-	return false;
-}
-
-bool CheckPhysicalDevice(uint32_t& graphicsQueueFamilyIndex, uint32_t& presentQueueFamilyIndex, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
-{
-	VkResult result;
-	uint32_t extensionCount;
-	result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
-	if (result != VK_SUCCESS || extensionCount == 0)
-	{
-		return false;
-	}
-	std::vector<VkExtensionProperties> extensions(extensionCount);
-	result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
-	if (result != VK_SUCCESS)
-	{
-		return false;
-	}
-
-	const char* desiredDeviceExtensions[]=
-	{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
-
-	for (auto desired : desiredDeviceExtensions)
-	{
-		if (!CheckExtensionAvailability(desired, extensions))
-		{
-			QMessageBox::critical(nullptr, "error", QString("could not find extension ") + desired);
-			return false;
-		}
-	}
-
-	VkPhysicalDeviceProperties physicalDeviceProperties;
-	VkPhysicalDeviceFeatures physicalDeviceFeatures;
-	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-	vkGetPhysicalDeviceFeatures(physicalDevice, &physicalDeviceFeatures);
-	uint32_t major_version = VK_API_VERSION_MAJOR(physicalDeviceProperties.apiVersion);
-	uint32_t minor_version = VK_API_VERSION_MINOR(physicalDeviceProperties.apiVersion);
-	uint32_t patch_version = VK_API_VERSION_PATCH(physicalDeviceProperties.apiVersion);
-	if (major_version < 1)
-	{
-		return false;
-	}
-	if (1 == major_version)
-	{
-		if (minor_version < 0)
-		{
-			return false;
-		}
-	}
-	uint32_t queueFamilyCount;
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
-	if (0 == queueFamilyCount)
-	{
-		return false;
-	}
-	
-	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
-	std::vector<VkBool32> queueFamilyPresentSupport(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &queueFamilyPresentSupport[i]);
-	}
-
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		if (queueFamilyProperties[i].queueCount > 0 &&
-			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT) &&
-			queueFamilyPresentSupport[i])
-		{
-			graphicsQueueFamilyIndex = i;
-			presentQueueFamilyIndex = i;
-			return true;
-		}
-	}
-
-	graphicsQueueFamilyIndex = UINT32_MAX;
-	presentQueueFamilyIndex = UINT32_MAX;
-
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		if (queueFamilyProperties[i].queueCount > 0 &&
-			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT))
-		{
-			graphicsQueueFamilyIndex = i;
-			break;
-		}
-	}
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		if (queueFamilyPresentSupport[i])
-		{
-			presentQueueFamilyIndex = i;
-			break;
-		}
-	}
-
-	return graphicsQueueFamilyIndex != UINT32_MAX && presentQueueFamilyIndex != UINT32_MAX;
-}
 
 Tutorial01::Tutorial01(QWidget *parent)
     : QMainWindow(parent)
@@ -146,34 +12,14 @@ Tutorial01::Tutorial01(QWidget *parent)
 	startTimer(0);
 
 
-	VkResult result;
-	uint32_t instanceExtensionCount;
-	result = vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, nullptr);
-	if (result != VK_SUCCESS || instanceExtensionCount == 0)
-	{
-		QMessageBox::critical(nullptr, "error", "enumerate instance extension failed");
-		return;
-	}
-	std::vector<VkExtensionProperties> instanceExtensions(instanceExtensionCount);
-	result = vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, instanceExtensions.data());
-	if (result != VK_SUCCESS || instanceExtensionCount == 0)
+	std::vector<VkExtensionProperties> instanceExtensions = GetInstanceExtensions();
+	if (instanceExtensions.empty())
 	{
 		QMessageBox::critical(nullptr, "error", "enumerate instance extension failed");
 		return;
 	}
 
-	const char* desiredInstanceExtensions[] =
-	{
-		VK_KHR_SURFACE_EXTENSION_NAME,
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-	  VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-#elif defined(VK_USE_PLATFORM_XCB_KHR)
-	  VK_KHR_XCB_SURFACE_EXTENSION_NAME
-#elif defined(VK_USE_PLATFORM_XLIB_KHR)
-	  VK_KHR_XLIB_SURFACE_EXTENSION_NAME
-#endif
-	};
-
+	std::vector<const char*> desiredInstanceExtensions = GetSurfaceInstanceExtensions();
 	for (auto desired : desiredInstanceExtensions)
 	{
 		if (!CheckExtensionAvailability(desired, instanceExtensions))
@@ -183,147 +29,39 @@ Tutorial01::Tutorial01(QWidget *parent)
 		}
 	}
 
-
-	VkApplicationInfo applicationInfo =
-	{
-		VK_STRUCTURE_TYPE_APPLICATION_INFO,
-		nullptr,
-		"Tutorial01",
-		VK_MAKE_VERSION(1,0,0),
-		"VulkanTutorials",
-		VK_MAKE_VERSION(1,0,0),
-		VK_API_VERSION_1_0,
-	};
-
-	VkInstanceCreateInfo instanceCreateInfo = 
-	{
-		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-		nullptr,
-		0,
-		&applicationInfo,
-		0,
-		nullptr,
-		sizeof(desiredInstanceExtensions)/sizeof(desiredInstanceExtensions[0]),
-		desiredInstanceExtensions
-	};
-
 	VkInstance instance;
-	result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
-	if (result != VK_SUCCESS)
+	if (!CreateInstance("Tutorial01", desiredInstanceExtensions, instance))
 	{
 		QMessageBox::critical(nullptr, "error", "create instance failed");
 		return;
 	}
 
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-	VkWin32SurfaceCreateInfoKHR surfaceCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
-		nullptr,
-		0,
-		GetModuleHandle(NULL),
-		(HWND)winId(),
-	};
-#endif
-
 	VkSurfaceKHR surface;
-	result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
-	if (result != VK_SUCCESS)
+	if (!CreateSurface(instance, (void*)winId(), surface))
 	{
 		QMessageBox::critical(nullptr, "error", "create surface failed");
 		return;
 	}
 
-	uint32_t physicalDeviceCount;
-	result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
-	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
-	{
-		QMessageBox::critical(nullptr, "error", "enumrate physical device failed");
-		return;
-	}
-	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-	result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
-	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
-	{
-		QMessageBox::critical(nullptr, "error", "enumrate physical device failed");
-		return;
-	}
-
-	struct CandidatePhysicalDevice
-	{
-		VkPhysicalDevice physicalDevice;
-		uint32_t graphicsQueueFamilyIndex;
-		uint32_t presentQueueFamilyIndex;
-	};
-	std::vector<CandidatePhysicalDevice> candidatePhysicalDevices;
-	for (uint32_t i = 0; i < physicalDeviceCount; ++i)
-	{
-		uint32_t graphicsQueueFamilyIndex, presentQueueFamilyIndex;
-		if (CheckPhysicalDevice(graphicsQueueFamilyIndex, presentQueueFamilyIndex, physicalDevices[i],surface))
-		{
-			CandidatePhysicalDevice candidatePhysicalDevice = { physicalDevices[i], graphicsQueueFamilyIndex, presentQueueFamilyIndex };
-			candidatePhysicalDevices.push_back(candidatePhysicalDevice);
-		}
-	}
-	if (candidatePhysicalDevices.empty())
+	PhysicalDeviceCandidate selectedPhysicalDevice;
+	if (!SelectPhysicalDevice(instance, surface, selectedPhysicalDevice))
 	{
 		QMessageBox::critical(nullptr, "error", "find physical device failed");
 		return;
 	}
 
-	CandidatePhysicalDevice selectedPhysicalDevice = candidatePhysicalDevices[0];
-
-	bool separateGraphicsPresentQueue = selectedPhysicalDevice.graphicsQueueFamilyIndex != selectedPhysicalDevice.presentQueueFamilyIndex;
-	float queuePriority = 1.0f;
-	VkDeviceQueueCreateInfo deviceQueueCreateInfo[2] =
-	{
-		{
-			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			nullptr,
-			0,
-			selectedPhysicalDevice.graphicsQueueFamilyIndex,
-			1,
-			&queuePriority
-		},
-		{
-			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			nullptr,
-			0,
-			selectedPhysicalDevice.presentQueueFamilyIndex,
-			1,
-			&queuePriority
-		},
-	};
-	const char* deviceExtensions[] =
+	std::vector<const char*> deviceExtensions =
 	{
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 
-
-	VkDeviceCreateInfo deviceCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		nullptr,
-		0,
-		separateGraphicsPresentQueue ? 2 : 1,
-		deviceQueueCreateInfo,
-		0,
-		nullptr,
-		sizeof(deviceExtensions)/sizeof(deviceExtensions[0]),
-		deviceExtensions,
-		nullptr
-	};
-
 	VkDevice device;
-	result = vkCreateDevice(selectedPhysicalDevice.physicalDevice, &deviceCreateInfo, nullptr, &device);
-	if (result != VK_SUCCESS)
+	VkQueue graphicsQueue, presentQueue;
+	if (!CreateDevice(selectedPhysicalDevice, deviceExtensions, nullptr, nullptr, device, graphicsQueue, presentQueue))
 	{
 		QMessageBox::critical(nullptr, "error", "create device failed");
 		return;
 	}
-	VkQueue graphicsQueue, presentQueue;
-	vkGetDeviceQueue(device, selectedPhysicalDevice.graphicsQueueFamilyIndex, 0, &graphicsQueue);
-	vkGetDeviceQueue(device, selectedPhysicalDevice.presentQueueFamilyIndex, 0, &presentQueue);
 
 	VkSemaphoreCreateInfo semaphoreCreateInfo =
 	{
@@ -336,10 +74,10 @@ Tutorial01::Tutorial01(QWidget *parent)
 	vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderingFinishedSemaphore);
 
 	m_surface = surface;
-	m_physicalDevice = selectedPhysicalDevice.physicalDevice;
+	m_physicalDevice = selectedPhysicalDevice.m_physicalDevice;
 	m_device = device;
-	m_graphicsQueueFamilyIndex = selectedPhysicalDevice.graphicsQueueFamilyIndex;
-	m_presentQueueFamilyIndex = selectedPhysicalDevice.presentQueueFamilyIndex;
+	m_graphicsQueueFamilyIndex = selectedPhysicalDevice.m_graphicsQueueFamilyIndex;
+	m_presentQueueFamilyIndex = selectedPhysicalDevice.m_presentQueueFamilyIndex;
 	m_graphicsQueue = graphicsQueue;
 	m_presentQueue = presentQueue;
 	m_imageAvailableSemaphore = imageAvailableSemaphore;
@@ -352,7 +90,6 @@ Tutorial01::~Tutorial01()
 
 bool Tutorial01::createSwapChain()
 {
-	VkResult result;
 	if (m_device != VK_NULL_HANDLE)
 	{
 		vkDeviceWaitIdle(m_device);
@@ -368,176 +105,30 @@ bool Tutorial01::createSwapChain()
 	}
 	m_swapChainImages.clear();
 
-	VkSurfaceCapabilitiesKHR surfaceCapabilities;
-	result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &surfaceCapabilities);
-	if (result != VK_SUCCESS)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface capabilities failed");
-		return false;
-	}
-	if (0 == (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
-	{
-		return false;
-	}
-	uint32_t formatCount;
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, m_surface, &formatCount, nullptr);
-	if (result != VK_SUCCESS || formatCount == 0)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface formats failed");
-		return false;
-	}
-	std::vector<VkSurfaceFormatKHR> formats(formatCount);
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, m_surface, &formatCount, formats.data());
-	if (result != VK_SUCCESS)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface formats failed");
-		return false;
-	}
-	uint32_t presentModeCount;
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &presentModeCount, nullptr);
-	if (result != VK_SUCCESS || presentModeCount == 0)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface present modes failed");
-		return false;
-	}
-	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &presentModeCount, presentModes.data());
-	if (result != VK_SUCCESS)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface present modes failed");
-		return false;
-	}
-
-	uint32_t desiredImageCount = 3;
-	desiredImageCount = min(desiredImageCount, surfaceCapabilities.maxImageCount);
-	desiredImageCount = max(desiredImageCount, surfaceCapabilities.minImageCount);
-
-	VkSurfaceFormatKHR desiredFormat = formats[0];
-	for (VkSurfaceFormatKHR &format : formats) 
+	SwapChainDesc swapChain;
+	VkSwapchainKHR oldSwapChain = m_swapChain;
+	if (!CreateSwapChain(m_physicalDevice, m_device, m_surface, 3, oldSwapChain, swapChain))
 	{
-		if (format.format == VK_FORMAT_R8G8B8A8_UNORM) 
+		for (SwapchainImage& image : swapChain.m_images)
 		{
-			desiredFormat = format;
-			break;
+			vkDestroyImageView(m_device, image.m_imageView, nullptr);
 		}
+		vkDestroySwapchainKHR(m_device, swapChain.m_swapChain, nullptr);
+		QMessageBox::critical(nullptr, "error", "create swapchain failed");
+		return false;
 	}
-	if (desiredFormat.format == VK_FORMAT_UNDEFINED)
-	{
-		desiredFormat.format = VK_FORMAT_R8G8B8A8_UNORM;
-		desiredFormat.colorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
-	}
-	VkExtent2D desiredExtent = surfaceCapabilities.currentExtent;
-	desiredExtent.width = min(desiredExtent.width, surfaceCapabilities.maxImageExtent.width);
-	desiredExtent.width = max(desiredExtent.width, surfaceCapabilities.minImageExtent.width);
-	desiredExtent.height = min(desiredExtent.height, surfaceCapabilities.maxImageExtent.height);
-	desiredExtent.height = max(desiredExtent.height, surfaceCapabilities.minImageExtent.height);
-	if (0 == desiredExtent.width || 0 == desiredExtent.height)
+	if (swapChain.m_swapChain == VK_NULL_HANDLE)
 	{
 		return true;
 	}
-
-	VkImageUsageFlags desiredUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-	
-	VkSurfaceTransformFlagBitsKHR desiredTransform = surfaceCapabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR : surfaceCapabilities.currentTransform;
-	
-	VkPresentModeKHR desiredPresentMode = presentModes[0];
-	for (VkPresentModeKHR presentMode : presentModes)
-	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-		{
-			desiredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
-			break;
-		}
-		else if (presentMode == VK_PRESENT_MODE_FIFO_KHR)
-		{
-			desiredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-		}
-	}
-	VkSwapchainKHR oldSwapChain = m_swapChain;
-
-	VkSwapchainCreateInfoKHR swapChainCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-		nullptr,
-		0,
-		m_surface,
-		desiredImageCount,
-		desiredFormat.format,
-		desiredFormat.colorSpace,
-		desiredExtent,
-		1,
-		desiredUsage,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-		desiredTransform,
-		VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		desiredPresentMode,
-		VK_TRUE,
-		oldSwapChain,
-	};
-
-	result = vkCreateSwapchainKHR(m_device, &swapChainCreateInfo, nullptr, &m_swapChain);
-	if (result != VK_SUCCESS)
-	{
-		m_swapChain = VK_NULL_HANDLE;
-		return false;
-	}
-	m_swapChainFormat = desiredFormat.format;
-	m_swapChainExtent = desiredExtent;
-
 	if (oldSwapChain != VK_NULL_HANDLE)
 	{
 		vkDestroySwapchainKHR(m_device, oldSwapChain, nullptr);
 	}
-
-	uint32_t imageCount = 0;
-	result = vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-	if (result != VK_SUCCESS || imageCount == 0)
-	{
-		return false;
-	}
-	std::vector<VkImage> images(imageCount);
-	result = vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, images.data());
-	if (result != VK_SUCCESS)
-	{
-		return false;
-	}
-	m_swapChainImages.resize(imageCount);
-	for (uint32_t i = 0; i < imageCount; ++i)
-	{
-		m_swapChainImages[i].m_image = images[i];
-	}
-	for (uint32_t i = 0; i < imageCount; ++i)
-	{
-		VkImageViewCreateInfo imageViewCreateInfo =
-		{
-			VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			nullptr,
-			0,
-			images[i],
-			VK_IMAGE_VIEW_TYPE_2D,
-			m_swapChainFormat,
-			{
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			},
-			{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0,
-				1,
-				0,
-				1,
-			},
-		};
-		result = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_swapChainImages[i].m_imageView);
-		if (result != VK_SUCCESS)
-		{
-			return false;
-		}
-	}
+	m_swapChain = swapChain.m_swapChain;
+	m_swapChainFormat = swapChain.m_format;
+	m_swapChainExtent = swapChain.m_extent;
+	m_swapChainImages.swap(swapChain.m_images);
 	return true;
 }
 
@@ -638,40 +229,13 @@ bool Tutorial01::createFrameBuffers()
 	return true;
 }
 
-VkShaderModule Tutorial01::createShaderModule(const char* fileName)
-{
-	VkResult result;
-	std::vector<char> shaderCode = GetBinaryFileContents(fileName);
-	if (shaderCode.empty())
-	{
-		return VK_NULL_HANDLE;
-	}
-
-	VkShaderModuleCreateInfo shaderModuleCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		nullptr,
-		0,
-		shaderCode.size(),
-		(const uint32_t*)shaderCode.data(),
-	};
-
-	VkShaderModule shaderModule;
-	result = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule);
-	if (result != VK_SUCCESS)
-	{
-		return VK_NULL_HANDLE;
-	}
-	return shaderModule;
-}
-
 bool Tutorial01::createPipeline()
 {
 	std::string path(QCoreApplication::applicationDirPath().toStdString());
 
 	VkResult result;
-	VkShaderModule vertexShaderModule = createShaderModule((path + "/shader01.vert.spv").c_str());
-	VkShaderModule fragmentShaderModule = createShaderModule((path + "/shader01.frag.spv").c_str());
+	VkShaderModule vertexShaderModule = CreateShaderModule(m_device, (path + "/shader01.vert.spv").c_str());
+	VkShaderModule fragmentShaderModule = CreateShaderModule(m_device, (path + "/shader01.frag.spv").c_str());
 	if (VK_NULL_HANDLE == vertexShaderModule || VK_NULL_HANDLE == fragmentShaderModule)
 	{
 		return false;
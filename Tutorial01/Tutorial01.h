@@ -2,16 +2,9 @@
 
 #include <QtWidgets/QMainWindow>
 #include "ui_Tutorial01.h"
-#define VK_USE_PLATFORM_WIN32_KHR
-#include <vulkan/vulkan.h>
+#include "VulkanUtils.h"
 #include <memory>
 
-struct SwapchainImage
-{
-	VkImage m_image{ VK_NULL_HANDLE };
-	VkImageView m_imageView{ VK_NULL_HANDLE };
-};
-
 class Tutorial01 : public QMainWindow
 {
     Q_OBJECT
@@ -32,7 +25,6 @@ private:
 	void clear();
 	bool draw();
 	bool onSizeWindow();
-	VkShaderModule createShaderModule(const char* fileName);
 private:
 	VkSurfaceKHR m_surface{ VK_NULL_HANDLE };
 	VkSwapchainKHR m_swapChain{ VK_NULL_HANDLE };
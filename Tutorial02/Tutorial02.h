@@ -2,32 +2,9 @@
 
 #include <QtWidgets/QMainWindow>
 #include "ui_Tutorial02.h"
-#define VK_USE_PLATFORM_WIN32_KHR
-#include <vulkan/vulkan.h>
+#include "VulkanUtils.h"
 #include <memory>
 
-struct SwapchainImage
-{
-	VkImage m_image{ VK_NULL_HANDLE };
-	VkImageView m_imageView{ VK_NULL_HANDLE };
-};
-
-struct VertexBuffer
-{
-	VkBuffer m_buffer{ VK_NULL_HANDLE };
-	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
-	uint32_t m_size{ 0 };
-};
-
-struct RenderingResource
-{
-	VkFramebuffer m_framebuffer{ VK_NULL_HANDLE };
-	VkCommandBuffer m_commandBuffer{ VK_NULL_HANDLE };
-	VkSemaphore m_imageAvailableSemaphore{ VK_NULL_HANDLE };
-	VkSemaphore m_renderingFinishedSemaphore{ VK_NULL_HANDLE };
-	VkFence m_fence{ VK_NULL_HANDLE };
-};
-
 class Tutorial02 : public QMainWindow
 {
     Q_OBJECT
@@ -50,7 +27,6 @@ private:
 	void clear();
 	bool draw();
 	bool onSizeWindow();
-	VkShaderModule createShaderModule(const char* fileName);
 private:
 	VkSurfaceKHR m_surface{ VK_NULL_HANDLE };
 	VkSwapchainKHR m_swapChain{ VK_NULL_HANDLE };
@@ -65,8 +41,9 @@ private:
 	VkCommandPool m_graphicsCommandPool{ VK_NULL_HANDLE };
 	std::vector<SwapchainImage> m_swapChainImages;
 	static const uint32_t rendering_resource_count = 3;
-	RenderingResource  m_renderingResources[rendering_resource_count];
+	std::vector<RenderingResource> m_renderingResources;
 	VertexBuffer m_vertexBuffer;
+	MemoryTracker m_memoryTracker;
 	VkRenderPass m_renderPass{ VK_NULL_HANDLE };
 	VkPipeline m_pipeline{ VK_NULL_HANDLE };
 private:
@@ -3,361 +3,522 @@
 #include<qmessagebox.h>
 #include <QAbstractEventDispatcher>
 #include <QDebug>
+#include <QThread>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QResizeEvent>
+#include <chrono>
+#include <QDateTime>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
 #define STB_IMAGE_IMPLEMENTATION
 #include "../Thirdparty/stb_image.h"
 
-std::vector<char> GetBinaryFileContents(char const* filename) {
-
-	std::ifstream file(filename, std::ios::binary);
-	if (file.fail()) {
-		std::cout << "Could not open \"" << filename << "\" file!" << std::endl;
-		return std::vector<char>();
-	}
-
-	std::streampos begin, end;
-	begin = file.tellg();
-	file.seekg(0, std::ios::end);
-	end = file.tellg();
-
-	std::vector<char> result(static_cast<size_t>(end - begin));
-	file.seekg(0, std::ios::beg);
-	file.read(&result[0], end - begin);
-	file.close();
+struct VertexData
+{
+	float x, y, z, w;
+	float u, v;
+};
+static_assert(sizeof(VertexData) == sizeof(ImmediateVertex), "overlay vertices are full float vertex data");
+// quads and meshes are both written as six packed floats a vertex
+static_assert(sizeof(VertexData) == 6 * sizeof(float) && sizeof(MeshVertex) == 6 * sizeof(float), "vertices are six packed floats");
+static_assert(offsetof(VertexData, u) == offsetof(MeshVertex, u), "mesh vertices are encoded like the quads");
+
+static const uint32_t overlay_triangles = 0;
+static const uint32_t overlay_lines = 1;
+static const uint32_t overlay_frame_count = 64;
+static const VkDeviceSize stream_region_size = 2 * 1024 * 1024;
+
+// VertexData as written, 32 bit float positions and texture coordinates. positions are always
+// binding 0, texture coordinates go to binding 1 when they get a stream of their own
+static VertexLayout FullVertexLayout(uint32_t texcoordBinding = 0)
+{
+	VertexLayout layout;
+	layout.add(0, AttributeFloat4).add(1, AttributeFloat2, texcoordBinding);
+	return layout;
+}
 
-	return result;
+// clip space positions and texture coordinates just outside [0, 1] both keep enough precision as
+// halves, normalized formats would clamp the texture coordinates
+static VertexLayout CompactVertexLayout(uint32_t texcoordBinding = 0)
+{
+	VertexLayout layout;
+	layout.add(0, AttributeHalf4).add(1, AttributeHalf2, texcoordBinding);
+	return layout;
 }
 
-bool CheckExtensionAvailability(const char* desired, std::vector<VkExtensionProperties>& availableExtensions)
+// vertex data holds one stream per binding, one after the other, each with every vertex
+static VkDeviceSize VertexStreamOffset(const VertexLayout& layout, uint32_t vertexCount, uint32_t binding)
 {
-	for (VkExtensionProperties& extension : availableExtensions)
+	VkDeviceSize offset = 0;
+	for (uint32_t i = 0; i < binding; ++i)
 	{
-		if (strcmp(desired, extension.extensionName) == 0)
-		{
-			return true;
-		}
+		offset += static_cast<VkDeviceSize>(vertexCount) * layout.stride(i);
 	}
-	return false;
+	return offset;
 }
 
-bool CheckPhysicalDevice(uint32_t& graphicsQueueFamilyIndex, uint32_t& presentQueueFamilyIndex, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+static void WriteVertexStreams(const VertexLayout& layout, const float* components, uint32_t firstVertex, uint32_t vertexCount, uint32_t streamVertexCount, void* data)
 {
-	VkResult result;
-	uint32_t extensionCount;
-	result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
-	if (result != VK_SUCCESS || extensionCount == 0)
-	{
-		return false;
-	}
-	std::vector<VkExtensionProperties> extensions(extensionCount);
-	result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
-	if (result != VK_SUCCESS)
+	for (uint32_t binding = 0; binding < layout.bindingCount(); ++binding)
 	{
-		return false;
+		char* stream = static_cast<char*>(data) + VertexStreamOffset(layout, streamVertexCount, binding);
+		layout.encode(components, vertexCount, binding, stream + static_cast<VkDeviceSize>(firstVertex) * layout.stride(binding));
 	}
+}
 
-	const char* desiredDeviceExtensions[]=
-	{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+// layers are stacked over the same grid, the first one furthest away
+static float QuadDepth(uint32_t quad, uint32_t quadCount, uint32_t layerCount)
+{
+	uint32_t quadsPerLayer = (quadCount + layerCount - 1) / layerCount;
+	return static_cast<float>(layerCount - 1 - quad / quadsPerLayer) / layerCount;
+}
 
-	for (auto desired : desiredDeviceExtensions)
-	{
-		if (!CheckExtensionAvailability(desired, extensions))
-		{
-			QMessageBox::critical(nullptr, "error", QString("could not find extension ") + desired);
-			return false;
-		}
-	}
+// the grid cell of a quad, every layer covers the same grid
+static void QuadRect(uint32_t quad, uint32_t quadCount, uint32_t layerCount, float& left, float& top, float& cellSize)
+{
+	uint32_t quadsPerLayer = (quadCount + layerCount - 1) / layerCount;
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(quadsPerLayer))));
+	uint32_t cell = quad % quadsPerLayer;
+	cellSize = 1.4f / columns;
+	left = -0.7f + cellSize * (cell % columns);
+	top = -0.7f + cellSize * (cell / columns);
+}
 
-	VkPhysicalDeviceProperties physicalDeviceProperties;
-	VkPhysicalDeviceFeatures physicalDeviceFeatures;
-	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-	vkGetPhysicalDeviceFeatures(physicalDevice, &physicalDeviceFeatures);
-	uint32_t major_version = VK_API_VERSION_MAJOR(physicalDeviceProperties.apiVersion);
-	uint32_t minor_version = VK_API_VERSION_MINOR(physicalDeviceProperties.apiVersion);
-	uint32_t patch_version = VK_API_VERSION_PATCH(physicalDeviceProperties.apiVersion);
-	if (major_version < 1)
-	{
-		return false;
-	}
-	if (1 == major_version)
+// centres the mesh on the quad grid, y is flipped to point down like clip space and z toward the viewer ends up nearer
+static void FitMeshToClipSpace(MeshData& mesh)
+{
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const MeshVertex& vertex : mesh.m_vertices)
 	{
-		if (minor_version < 0)
+		const float position[3] = { vertex.x, vertex.y, vertex.z };
+		for (uint32_t i = 0; i < 3; ++i)
 		{
-			return false;
+			minimum[i] = min(minimum[i], position[i]);
+			maximum[i] = max(maximum[i], position[i]);
 		}
 	}
-	uint32_t queueFamilyCount;
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
-	if (0 == queueFamilyCount)
+	float extent = max(max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+	float scale = extent > 0.0f ? 1.4f / extent : 1.0f;
+	for (MeshVertex& vertex : mesh.m_vertices)
 	{
-		return false;
-	}
-	
-	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
-	std::vector<VkBool32> queueFamilyPresentSupport(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &queueFamilyPresentSupport[i]);
-	}
-
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		if (queueFamilyProperties[i].queueCount > 0 &&
-			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT) &&
-			queueFamilyPresentSupport[i])
-		{
-			graphicsQueueFamilyIndex = i;
-			presentQueueFamilyIndex = i;
-			return true;
-		}
+		vertex.x = (vertex.x - (minimum[0] + maximum[0]) * 0.5f) * scale;
+		vertex.y = -(vertex.y - (minimum[1] + maximum[1]) * 0.5f) * scale;
+		vertex.z = 0.5f - (vertex.z - (minimum[2] + maximum[2]) * 0.5f) * scale * 0.5f;
+		vertex.w = 1.0f;
 	}
+}
 
-	graphicsQueueFamilyIndex = UINT32_MAX;
-	presentQueueFamilyIndex = UINT32_MAX;
-
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
-	{
-		if (queueFamilyProperties[i].queueCount > 0 &&
-			queueFamilyProperties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT))
+// a flat square of two triangles per cell over the quad grid, counter-clockwise on screen like the quads
+static void GenerateGridMesh(uint32_t cellCount, MeshData& mesh)
+{
+	uint32_t rowSize = cellCount + 1;
+	mesh.m_vertices.clear();
+	mesh.m_indices.clear();
+	mesh.m_vertices.reserve(rowSize * rowSize);
+	mesh.m_indices.reserve(cellCount * cellCount * 6);
+	for (uint32_t y = 0; y < rowSize; ++y)
+	{
+		for (uint32_t x = 0; x < rowSize; ++x)
 		{
-			graphicsQueueFamilyIndex = i;
-			break;
+			float u = static_cast<float>(x) / cellCount;
+			float v = static_cast<float>(y) / cellCount;
+			mesh.m_vertices.push_back({ -0.7f + 1.4f * u, -0.7f + 1.4f * v, 0.5f, 1.0f, u, v });
 		}
 	}
-	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	for (uint32_t y = 0; y < cellCount; ++y)
 	{
-		if (queueFamilyPresentSupport[i])
+		for (uint32_t x = 0; x < cellCount; ++x)
 		{
-			presentQueueFamilyIndex = i;
-			break;
+			uint32_t topLeft = y * rowSize + x;
+			uint32_t bottomLeft = topLeft + rowSize;
+			const uint32_t cell[] = { topLeft, bottomLeft, topLeft + 1, topLeft + 1, bottomLeft, bottomLeft + 1 };
+			mesh.m_indices.insert(mesh.m_indices.end(), cell, cell + 6);
 		}
 	}
-
-	return graphicsQueueFamilyIndex != UINT32_MAX && presentQueueFamilyIndex != UINT32_MAX;
 }
 
-
-struct VertexData
+// lays the quads out on a grid, a non zero phase wobbles every quad so streamed frames differ
+static void WriteQuadVertices(const VertexLayout& layout, void* data, uint32_t quadCount, uint32_t layerCount, float phase)
 {
-	float x, y, z, w;
-	float u, v;
-};
+	VertexData vertexData[4];
+	for (uint32_t i = 0; i < quadCount; ++i)
+	{
+		float left, top, cellSize;
+		QuadRect(i, quadCount, layerCount, left, top, cellSize);
+		float wobble = phase == 0.0f ? 0.0f : 0.1f * cellSize * std::sin(phase + i);
+		left += wobble;
+		top += wobble;
+		float right = left + cellSize;
+		float bottom = top + cellSize;
+		float depth = QuadDepth(i, quadCount, layerCount);
+		vertexData[0] = { left, top, depth, 1.0f, -0.1f, -0.1f };
+		vertexData[1] = { left, bottom, depth, 1.0f, -0.1f, 1.1f };
+		vertexData[2] = { right, top, depth, 1.0f, 1.1f, -0.1f };
+		vertexData[3] = { right, bottom, depth, 1.0f, 1.1f, 1.1f };
+		WriteVertexStreams(layout, &vertexData[0].x, i * 4, 4, quadCount * 4, data);
+	}
+}
 
-Tutorial03::Tutorial03(QWidget *parent)
+Tutorial03::Tutorial03(const RenderSettings& settings, QWidget *parent)
     : QMainWindow(parent)
+	, m_settings(settings)
 {
     ui.setupUi(this);
-	startTimer(0);
-
-
-	VkResult result;
-	uint32_t instanceExtensionCount;
-	result = vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, nullptr);
-	if (result != VK_SUCCESS || instanceExtensionCount == 0)
-	{
-		QMessageBox::critical(nullptr, "error", "enumerate instance extension failed");
-		return;
-	}
-	std::vector<VkExtensionProperties> instanceExtensions(instanceExtensionCount);
-	result = vkEnumerateInstanceExtensionProperties(nullptr, &instanceExtensionCount, instanceExtensions.data());
-	if (result != VK_SUCCESS || instanceExtensionCount == 0)
+	m_settings.m_framesInFlight = min(max(m_settings.m_framesInFlight, 1u), 4u);
+	m_settings.m_swapChainImageCount = min(max(m_settings.m_swapChainImageCount, 2u), 5u);
+	m_settings.m_quadCount = min(max(m_settings.m_quadCount, 1u), 65536u);
+	m_settings.m_sampleCount = min(max(m_settings.m_sampleCount, 1u), 8u);
+	m_settings.m_quadLayers = min(max(m_settings.m_quadLayers, 1u), m_settings.m_quadCount);
+	m_settings.m_textureCount = min(max(m_settings.m_textureCount, 1u), 256u);
+	m_settings.m_materialCount = min(max(m_settings.m_materialCount, 1u), 4096u);
+	m_settings.m_meshGridSize = min(m_settings.m_meshGridSize, 1024u);
+	m_settings.m_depth = m_settings.m_depth || m_settings.m_depthPrepass;
+	uint32_t texcoordBinding = m_settings.m_splitVertices ? 1 : 0;
+	m_vertexLayout = m_settings.m_compactVertices ? CompactVertexLayout(texcoordBinding) : FullVertexLayout(texcoordBinding);
+	qDebug() << "frames in flight" << m_settings.m_framesInFlight << "swapchain images" << m_settings.m_swapChainImageCount;
+	m_frameStatistics.setKeepSamples(!m_settings.m_statisticsCsvFile.empty());
+
+
+	std::vector<VkExtensionProperties> instanceExtensions = GetInstanceExtensions();
+	if (instanceExtensions.empty())
 	{
 		QMessageBox::critical(nullptr, "error", "enumerate instance extension failed");
 		return;
 	}
 
-	const char* desiredInstanceExtensions[] =
-	{
-		VK_KHR_SURFACE_EXTENSION_NAME,
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-	  VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-#elif defined(VK_USE_PLATFORM_XCB_KHR)
-	  VK_KHR_XCB_SURFACE_EXTENSION_NAME
-#elif defined(VK_USE_PLATFORM_XLIB_KHR)
-	  VK_KHR_XLIB_SURFACE_EXTENSION_NAME
-#endif
-	};
-
-	for (auto desired : desiredInstanceExtensions)
+	std::vector<const char*> enabledInstanceExtensions;
+	if (!m_settings.m_headless)
 	{
-		if (!CheckExtensionAvailability(desired, instanceExtensions))
+		enabledInstanceExtensions = GetSurfaceInstanceExtensions();
+		for (auto desired : enabledInstanceExtensions)
 		{
-			QMessageBox::critical(nullptr, "error", QString("could not find extension ") + desired);
-			return;
+			if (!CheckExtensionAvailability(desired, instanceExtensions))
+			{
+				QMessageBox::critical(nullptr, "error", QString("could not find extension ") + desired);
+				return;
+			}
 		}
 	}
-
-
-	VkApplicationInfo applicationInfo =
-	{
-		VK_STRUCTURE_TYPE_APPLICATION_INFO,
-		nullptr,
-		"Tutorial03",
-		VK_MAKE_VERSION(1,0,0),
-		"VulkanTutorials",
-		VK_MAKE_VERSION(1,0,0),
-		VK_API_VERSION_1_0,
-	};
-
-	VkInstanceCreateInfo instanceCreateInfo = 
+	bool physicalDeviceProperties2Supported = CheckExtensionAvailability(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME, instanceExtensions);
+	if (physicalDeviceProperties2Supported)
 	{
-		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-		nullptr,
-		0,
-		&applicationInfo,
-		0,
-		nullptr,
-		sizeof(desiredInstanceExtensions)/sizeof(desiredInstanceExtensions[0]),
-		desiredInstanceExtensions
-	};
+		enabledInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
 
 	VkInstance instance;
-	result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
-	if (result != VK_SUCCESS)
+	if (!CreateInstance("Tutorial03", enabledInstanceExtensions, instance))
 	{
 		QMessageBox::critical(nullptr, "error", "create instance failed");
 		return;
 	}
+	m_instance = instance;
 
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-	VkWin32SurfaceCreateInfoKHR surfaceCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
-		nullptr,
-		0,
-		GetModuleHandle(NULL),
-		(HWND)winId(),
-	};
-#endif
-
-	VkSurfaceKHR surface;
-	result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
-	if (result != VK_SUCCESS)
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	if (!m_settings.m_headless && !CreateSurface(instance, (void*)winId(), surface))
 	{
 		QMessageBox::critical(nullptr, "error", "create surface failed");
 		return;
 	}
+	m_surface = surface;
 
-	uint32_t physicalDeviceCount;
-	result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
-	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
+	PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 = nullptr;
+	if (physicalDeviceProperties2Supported)
 	{
-		QMessageBox::critical(nullptr, "error", "enumrate physical device failed");
-		return;
+		getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
 	}
-	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-	result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
-	if (result != VK_SUCCESS || 0 == physicalDeviceCount)
+	std::vector<PhysicalDeviceCandidate> candidatePhysicalDevices = RankPhysicalDevices(instance, surface, nullptr, getProperties2);
+	if (candidatePhysicalDevices.empty())
 	{
-		QMessageBox::critical(nullptr, "error", "enumrate physical device failed");
+		QMessageBox::critical(nullptr, "error", "find physical device failed");
 		return;
 	}
+	for (const PhysicalDeviceCandidate& candidate : candidatePhysicalDevices)
+	{
+		qDebug() << "physical device" << candidate.m_name.c_str() << candidate.m_uuid.c_str() << "score" << candidate.m_score << "device local" << candidate.m_deviceLocalMemory / (1024 * 1024) << "MB";
+	}
+	PhysicalDeviceCandidate selectedPhysicalDevice = candidatePhysicalDevices[0];
+	qDebug() << "selected physical device" << selectedPhysicalDevice.m_name.c_str() << "override with" << physical_device_override_variable;
+
+	std::vector<const char*> deviceExtensions;
+	if (!m_settings.m_headless)
+	{
+		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 
-	struct CandidatePhysicalDevice
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures =
+	{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+		nullptr,
+		VK_FALSE,
+	};
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features =
 	{
-		VkPhysicalDevice physicalDevice;
-		uint32_t graphicsQueueFamilyIndex;
-		uint32_t presentQueueFamilyIndex;
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
+		nullptr,
+		VK_FALSE,
 	};
-	std::vector<CandidatePhysicalDevice> candidatePhysicalDevices;
-	for (uint32_t i = 0; i < physicalDeviceCount; ++i)
+	std::vector<VkExtensionProperties> availableDeviceExtensions = GetDeviceExtensions(selectedPhysicalDevice.m_physicalDevice);
+	bool timelineSemaphoreExtension = CheckExtensionAvailability(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, availableDeviceExtensions);
+	bool synchronization2Extension = CheckExtensionAvailability(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, availableDeviceExtensions);
+	if (physicalDeviceProperties2Supported && (timelineSemaphoreExtension || synchronization2Extension))
 	{
-		uint32_t graphicsQueueFamilyIndex, presentQueueFamilyIndex;
-		if (CheckPhysicalDevice(graphicsQueueFamilyIndex, presentQueueFamilyIndex, physicalDevices[i],surface))
+		PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+		timelineSemaphoreFeatures.pNext = synchronization2Extension ? &synchronization2Features : nullptr;
+		VkPhysicalDeviceFeatures2KHR physicalDeviceFeatures2 =
 		{
-			CandidatePhysicalDevice candidatePhysicalDevice = { physicalDevices[i], graphicsQueueFamilyIndex, presentQueueFamilyIndex };
-			candidatePhysicalDevices.push_back(candidatePhysicalDevice);
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+			timelineSemaphoreExtension ? static_cast<void*>(&timelineSemaphoreFeatures) : timelineSemaphoreFeatures.pNext,
+		};
+		if (getPhysicalDeviceFeatures2 != nullptr)
+		{
+			getPhysicalDeviceFeatures2(selectedPhysicalDevice.m_physicalDevice, &physicalDeviceFeatures2);
 		}
+		timelineSemaphoreFeatures.pNext = nullptr;
 	}
-	if (candidatePhysicalDevices.empty())
+	// only the features of enabled extensions go into the device create chain
+	void* deviceFeatures = nullptr;
+	bool synchronization2Supported = synchronization2Features.synchronization2 == VK_TRUE;
+	if (synchronization2Supported)
 	{
-		QMessageBox::critical(nullptr, "error", "find physical device failed");
-		return;
+		deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		deviceFeatures = &synchronization2Features;
+	}
+	bool timelineSemaphoreSupported = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+	if (timelineSemaphoreSupported)
+	{
+		deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineSemaphoreFeatures.pNext = deviceFeatures;
+		deviceFeatures = &timelineSemaphoreFeatures;
 	}
 
-	CandidatePhysicalDevice selectedPhysicalDevice = candidatePhysicalDevices[0];
-
-	bool separateGraphicsPresentQueue = selectedPhysicalDevice.graphicsQueueFamilyIndex != selectedPhysicalDevice.presentQueueFamilyIndex;
-	float queuePriority = 1.0f;
-	VkDeviceQueueCreateInfo deviceQueueCreateInfo[2] =
+#if defined(_WIN32)
+	VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+	VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+	bool calibratedTimestampsSupported = false;
+	PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT getCalibrateableTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+	if (getCalibrateableTimeDomains != nullptr && CheckExtensionAvailability(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, availableDeviceExtensions))
 	{
-		{
-			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			nullptr,
-			0,
-			selectedPhysicalDevice.graphicsQueueFamilyIndex,
-			1,
-			&queuePriority
-		},
-		{
-			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			nullptr,
-			0,
-			selectedPhysicalDevice.presentQueueFamilyIndex,
-			1,
-			&queuePriority
-		},
-	};
-	const char* deviceExtensions[] =
+		uint32_t timeDomainCount = 0;
+		getCalibrateableTimeDomains(selectedPhysicalDevice.m_physicalDevice, &timeDomainCount, nullptr);
+		std::vector<VkTimeDomainEXT> timeDomains(timeDomainCount);
+		getCalibrateableTimeDomains(selectedPhysicalDevice.m_physicalDevice, &timeDomainCount, timeDomains.data());
+		bool deviceDomain = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != timeDomains.end();
+		bool hostDomain = std::find(timeDomains.begin(), timeDomains.end(), hostTimeDomain) != timeDomains.end();
+		calibratedTimestampsSupported = deviceDomain && hostDomain;
+	}
+	if (calibratedTimestampsSupported)
 	{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
-
+		deviceExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+	}
 
-	VkDeviceCreateInfo deviceCreateInfo =
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+	if (physicalDeviceProperties2Supported && CheckExtensionAvailability(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, availableDeviceExtensions))
 	{
-		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		nullptr,
-		0,
-		separateGraphicsPresentQueue ? 2 : 1,
-		deviceQueueCreateInfo,
-		0,
-		nullptr,
-		sizeof(deviceExtensions)/sizeof(deviceExtensions[0]),
-		deviceExtensions,
-		nullptr
-	};
+		getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+	if (getMemoryProperties2 != nullptr)
+	{
+		deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
+	VkPhysicalDeviceFeatures availableFeatures;
+	vkGetPhysicalDeviceFeatures(selectedPhysicalDevice.m_physicalDevice, &availableFeatures);
+	VkPhysicalDeviceFeatures enabledFeatures = {};
+	enabledFeatures.pipelineStatisticsQuery = m_settings.m_pipelineStatistics ? availableFeatures.pipelineStatisticsQuery : VK_FALSE;
 
 	VkDevice device;
-	result = vkCreateDevice(selectedPhysicalDevice.physicalDevice, &deviceCreateInfo, nullptr, &device);
-	if (result != VK_SUCCESS)
+	VkQueue graphicsQueue, presentQueue;
+	if (!CreateDevice(selectedPhysicalDevice, deviceExtensions, &enabledFeatures, deviceFeatures, device, graphicsQueue, presentQueue))
 	{
 		QMessageBox::critical(nullptr, "error", "create device failed");
 		return;
 	}
-	VkQueue graphicsQueue, presentQueue;
-	vkGetDeviceQueue(device, selectedPhysicalDevice.graphicsQueueFamilyIndex, 0, &graphicsQueue);
-	vkGetDeviceQueue(device, selectedPhysicalDevice.presentQueueFamilyIndex, 0, &presentQueue);
 
-
-	m_surface = surface;
-	m_physicalDevice = selectedPhysicalDevice.physicalDevice;
+	m_physicalDevice = selectedPhysicalDevice.m_physicalDevice;
 	m_device = device;
-	m_graphicsQueueFamilyIndex = selectedPhysicalDevice.graphicsQueueFamilyIndex;
-	m_presentQueueFamilyIndex = selectedPhysicalDevice.presentQueueFamilyIndex;
+	m_graphicsQueueFamilyIndex = selectedPhysicalDevice.m_graphicsQueueFamilyIndex;
+	m_presentQueueFamilyIndex = selectedPhysicalDevice.m_presentQueueFamilyIndex;
 	m_graphicsQueue = graphicsQueue;
 	m_presentQueue = presentQueue;
+	if (timelineSemaphoreSupported)
+	{
+		m_vkWaitSemaphoresKHR = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+		m_vkGetSemaphoreCounterValueKHR = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+		m_timelineSemaphoreSupported = m_vkWaitSemaphoresKHR != nullptr && m_vkGetSemaphoreCounterValueKHR != nullptr;
+	}
+	qDebug() << "timeline semaphore" << (m_timelineSemaphoreSupported ? "enabled" : "not available, using fences");
+	if (calibratedTimestampsSupported)
+	{
+		m_vkGetCalibratedTimestampsEXT = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT");
+		m_hostTimeDomain = hostTimeDomain;
+	}
+	m_memoryTracker.init(m_physicalDevice, getMemoryProperties2);
+	m_memoryTracker.setEvictionCallback([this](uint32_t heapIndex, const MemoryHeapUsage& usage) { evictMemory(heapIndex, usage); });
+	qDebug() << "memory budget" << (m_memoryTracker.budgetSupported() ? "enabled" : "not available, using heap sizes");
+	m_renderGraph.init(m_device, m_physicalDevice, m_graphicsQueueFamilyIndex, &m_memoryTracker, [this](std::function<void()> deleter) { retire(deleter); });
+	m_renderGraph.setProfiler(&m_gpuProfiler);
+	m_uploadGraph.init(m_device, m_physicalDevice, m_graphicsQueueFamilyIndex);
+	m_uploadGraph.setProfiler(&m_gpuProfiler);
+	if (synchronization2Supported)
+	{
+		PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+		m_renderGraph.setSynchronization2(cmdPipelineBarrier2);
+		m_uploadGraph.setSynchronization2(cmdPipelineBarrier2);
+	}
+	qDebug() << "synchronization2" << (synchronization2Supported ? "enabled" : "not available, merging barrier stages");
+	m_sampleCount = SelectSampleCount(m_physicalDevice, m_settings.m_sampleCount);
+	if (static_cast<uint32_t>(m_sampleCount) != m_settings.m_sampleCount)
+	{
+		qDebug() << "msaa" << m_settings.m_sampleCount << "samples not supported, using" << static_cast<uint32_t>(m_sampleCount);
+	}
+	if (m_settings.m_depth)
+	{
+		m_depthFormat = SelectDepthFormat(m_physicalDevice);
+		qDebug() << "depth" << (m_depthFormat != VK_FORMAT_UNDEFINED ? "enabled" : "not available");
+	}
+	m_pipelineStatisticsQuery = enabledFeatures.pipelineStatisticsQuery == VK_TRUE;
+	if (m_settings.m_pipelineStatistics && !m_pipelineStatisticsQuery)
+	{
+		qDebug() << "pipeline statistics queries not supported";
+	}
+	Tracer::instance().setThreadName(Tracer::currentThreadId(), "gui");
+	Tracer::instance().setThreadName(Tracer::gpu_thread_id, "gpu");
 
-	init();
+	m_ready = init();
+	if (m_ready && !m_settings.m_headless)
+	{
+		startRenderThread();
+	}
 }
 
 Tutorial03::~Tutorial03()
 {
+	stopRenderThread();
+	if (!m_settings.m_statisticsCsvFile.empty() && !m_frameStatistics.writeCsv(m_settings.m_statisticsCsvFile))
+	{
+		qWarning() << "could not write frame statistics" << m_settings.m_statisticsCsvFile.c_str();
+	}
 	clear();
 }
 
+bool Tutorial03::isReady() const
+{
+	return m_ready;
+}
+
+bool Tutorial03::renderFrame()
+{
+	processEvents();
+	if (m_swapChainDirty && !onSizeWindow())
+	{
+		return false;
+	}
+	if (m_swapChainDirty || m_swapChainImages.empty())
+	{
+		return true;
+	}
+	return draw();
+}
+
+void Tutorial03::resize(uint32_t width, uint32_t height)
+{
+	m_settings.m_width = width;
+	m_settings.m_height = height;
+	m_swapChainDirty = true;
+}
+
+bool Tutorial03::waitIdle()
+{
+	return waitForSerial(m_submittedSerial);
+}
+
+std::string Tutorial03::deviceName() const
+{
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &physicalDeviceProperties);
+	return physicalDeviceProperties.deviceName;
+}
+
+std::vector<GpuScopeStatistics> Tutorial03::gpuStatistics() const
+{
+	return m_gpuProfiler.statistics();
+}
+
+std::vector<GpuPipelineStatistics> Tutorial03::gpuPipelineStatistics() const
+{
+	return m_gpuProfiler.pipelineStatistics();
+}
+
+bool Tutorial03::vertexDirectWrite() const
+{
+	return m_vertexBuffer.m_mappedData != nullptr;
+}
+
+uint64_t Tutorial03::streamedVertexBytes() const
+{
+	return m_streamedVertexBytes;
+}
+
+uint32_t Tutorial03::vertexSize() const
+{
+	return m_vertexLayout.vertexSize();
+}
+
+uint32_t Tutorial03::positionStride() const
+{
+	return m_vertexLayout.stride(0);
+}
+
+uint64_t Tutorial03::readbackFrames() const
+{
+	return m_readbackRing.readbackFrames();
+}
+
+uint64_t Tutorial03::skippedReadbackFrames() const
+{
+	return m_readbackRing.skippedFrames();
+}
+
+DrawListCounters Tutorial03::drawListCounters() const
+{
+	return m_drawList.counters();
+}
+
+DrawListCounters Tutorial03::prepassCounters() const
+{
+	return m_prepassCounters;
+}
+
+uint32_t Tutorial03::sampleCount() const
+{
+	return m_sampleCount;
+}
+
+bool Tutorial03::multisampleMemoryLazy() const
+{
+	return m_multisampleLazy;
+}
+
 bool Tutorial03::init()
 {
 	if (!createSwapChain())
 	{
 		return false;
 	}
+	if (!createReadbackRing())
+	{
+		return false;
+	}
 	if (!createRenderingResources())
 	{
 		return false;
@@ -378,6 +539,14 @@ bool Tutorial03::init()
 	{
 		return false;
 	}
+	if (!createStreamBuffer())
+	{
+		return false;
+	}
+	if (!createMesh())
+	{
+		return false;
+	}
 	if (!createUniformBuffer())
 	{
 		return false;
@@ -395,248 +564,330 @@ bool Tutorial03::init()
 
 void Tutorial03::clear()
 {
-	if (m_device != VK_NULL_HANDLE)
+	if (m_device == VK_NULL_HANDLE)
 	{
-		vkDeviceWaitIdle(m_device);
-		VkCommandBuffer commandBuffers[rendering_resource_count];
-		for (uint32_t i =0; i< rendering_resource_count;++i)
+		return;
+	}
+	waitForSerial(m_submittedSerial);
+	vkQueueWaitIdle(m_presentQueue);
+
+	retireSwapChain(m_swapChain, m_swapChainImages);
+	m_swapChain = VK_NULL_HANDLE;
+	retirePipeline();
+	retireBuffer(m_stagingBuffer.m_buffer, m_stagingBuffer.m_deviceMemory);
+	retireBuffer(m_vertexBuffer.m_buffer, m_vertexBuffer.m_deviceMemory);
+	retireBuffer(m_vertexStagingBuffer.m_buffer, m_vertexStagingBuffer.m_deviceMemory);
+	retireBuffer(m_meshVertexBuffer.m_buffer, m_meshVertexBuffer.m_deviceMemory);
+	retireBuffer(m_meshIndexBuffer.m_buffer, m_meshIndexBuffer.m_deviceMemory);
+	retireBuffer(m_uniformBuffer.m_buffer, m_uniformBuffer.m_deviceMemory);
+	m_streamBuffer.clear();
+	for (Texture& texture : m_textures)
+	{
+		retireTexture(texture);
+	}
+	retireDescriptorSet(m_descriptorSet);
+	m_renderGraph.clear();
+	m_uploadGraph.clear();
+	m_readbackRing.clear();
+	m_deletionQueue.flush(UINT64_MAX);
+	m_gpuProfiler.clear();
+
+	if (m_graphicsCommandPool != VK_NULL_HANDLE)
+	{
+		DestroyRenderingResources(m_device, m_graphicsCommandPool, m_renderingResources);
+		vkFreeCommandBuffers(m_device, m_graphicsCommandPool, 1, &m_uploadCommandBuffer);
+		vkDestroyFence(m_device, m_uploadFence, nullptr);
+		vkDestroySemaphore(m_device, m_timelineSemaphore, nullptr);
+		vkDestroyCommandPool(m_device, m_graphicsCommandPool, nullptr);
+		m_graphicsCommandPool = VK_NULL_HANDLE;
+	}
+
+	vkDestroyDevice(m_device, nullptr);
+	m_device = VK_NULL_HANDLE;
+	if (m_surface != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		m_surface = VK_NULL_HANDLE;
+	}
+	vkDestroyInstance(m_instance, nullptr);
+	m_instance = VK_NULL_HANDLE;
+}
+
+void Tutorial03::retire(std::function<void()> deleter)
+{
+	m_deletionQueue.push(m_submittedSerial, std::move(deleter));
+}
+
+void Tutorial03::retireBuffer(VkBuffer& buffer, VkDeviceMemory& deviceMemory)
+{
+	VkDevice device = m_device;
+	MemoryTracker* memoryTracker = &m_memoryTracker;
+	VkBuffer oldBuffer = buffer;
+	VkDeviceMemory oldDeviceMemory = deviceMemory;
+	retire([device, memoryTracker, oldBuffer, oldDeviceMemory]() {
+		vkDestroyBuffer(device, oldBuffer, nullptr);
+		memoryTracker->free(device, oldDeviceMemory);
+	});
+	buffer = VK_NULL_HANDLE;
+	deviceMemory = VK_NULL_HANDLE;
+}
+
+void Tutorial03::retireTexture(Texture& texture)
+{
+	VkDevice device = m_device;
+	MemoryTracker* memoryTracker = &m_memoryTracker;
+	Texture oldTexture = texture;
+	retire([device, memoryTracker, oldTexture]() {
+		vkDestroySampler(device, oldTexture.m_sampler, nullptr);
+		vkDestroyImageView(device, oldTexture.m_imageView, nullptr);
+		vkDestroyImage(device, oldTexture.m_image, nullptr);
+		memoryTracker->free(device, oldTexture.m_deviceMemory);
+	});
+	texture = Texture();
+}
+
+void Tutorial03::retireDescriptorSet(DescriptorSet& descriptorSet)
+{
+	VkDevice device = m_device;
+	DescriptorSet oldDescriptorSet = descriptorSet;
+	retire([device, oldDescriptorSet]() {
+		vkDestroyDescriptorPool(device, oldDescriptorSet.m_descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device, oldDescriptorSet.m_descriptorSetLayout, nullptr);
+	});
+	descriptorSet = DescriptorSet();
+}
+
+void Tutorial03::retireSwapChain(VkSwapchainKHR swapChain, std::vector<SwapchainImage>& images)
+{
+	VkDevice device = m_device;
+	MemoryTracker* memoryTracker = &m_memoryTracker;
+	std::vector<SwapchainImage> oldImages;
+	oldImages.swap(images);
+	retire([device, memoryTracker, swapChain, oldImages]() {
+		for (const SwapchainImage& image : oldImages)
 		{
-			commandBuffers[i] = m_renderingResources[i].m_commandBuffer;
+			vkDestroyImageView(device, image.m_imageView, nullptr);
+			if (image.m_deviceMemory != VK_NULL_HANDLE)
+			{
+				vkDestroyImage(device, image.m_image, nullptr);
+				memoryTracker->free(device, image.m_deviceMemory);
+			}
 		}
-		vkFreeCommandBuffers(m_device, m_graphicsCommandPool, rendering_resource_count, commandBuffers);
-		for (uint32_t i = 0; i < rendering_resource_count; ++i)
+		if (swapChain != VK_NULL_HANDLE)
 		{
-			vkDestroyFramebuffer(m_device, m_renderingResources[i].m_framebuffer, nullptr);
-			vkDestroySemaphore(m_device, m_renderingResources[i].m_imageAvailableSemaphore, nullptr);
-			vkDestroySemaphore(m_device, m_renderingResources[i].m_renderingFinishedSemaphore, nullptr);
-			vkDestroyFence(m_device, m_renderingResources[i].m_fence, nullptr);
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
 		}
+	});
+}
 
-		if (m_graphicsCommandPool != VK_NULL_HANDLE)
-		{
-			vkDestroyCommandPool(m_device, m_graphicsCommandPool, nullptr);
-			m_graphicsCommandPool = VK_NULL_HANDLE;
-		}
-		if (m_pipeline != VK_NULL_HANDLE)
+void Tutorial03::retirePipeline()
+{
+	VkDevice device = m_device;
+	VkPipeline pipeline = m_pipeline;
+	VkPipeline meshPipeline = m_meshPipeline;
+	VkPipelineLayout pipelineLayout = m_pipelineLayout;
+	VkRenderPass renderPass = m_renderPass;
+	std::vector<VkPipeline> overlayPipelines;
+	overlayPipelines.swap(m_overlayPipelines);
+	std::vector<VkPipeline> prepassPipelines;
+	prepassPipelines.swap(m_prepassPipelines);
+	retire([device, pipeline, meshPipeline, pipelineLayout, renderPass, overlayPipelines, prepassPipelines]() {
+		vkDestroyPipeline(device, pipeline, nullptr);
+		vkDestroyPipeline(device, meshPipeline, nullptr);
+		for (VkPipeline overlayPipeline : overlayPipelines)
 		{
-			vkDestroyPipeline(m_device, m_pipeline, nullptr);
-			m_pipeline = VK_NULL_HANDLE;
+			vkDestroyPipeline(device, overlayPipeline, nullptr);
 		}
-		if (m_renderPass != VK_NULL_HANDLE)
+		for (VkPipeline prepassPipeline : prepassPipelines)
 		{
-			vkDestroyRenderPass(m_device, m_renderPass, nullptr);
-			m_renderPass = VK_NULL_HANDLE;
+			vkDestroyPipeline(device, prepassPipeline, nullptr);
 		}
-	}
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
+	});
+	m_pipeline = VK_NULL_HANDLE;
+	m_meshPipeline = VK_NULL_HANDLE;
+	m_pipelineLayout = VK_NULL_HANDLE;
+	m_renderPass = VK_NULL_HANDLE;
 }
 
 
 bool Tutorial03::createSwapChain()
 {
-	VkResult result;
-	if (m_device != VK_NULL_HANDLE)
+	TRACE_FUNCTION();
+	if (m_settings.m_headless)
 	{
-		vkDeviceWaitIdle(m_device);
+		return createOffscreenTargets();
 	}
-
-	for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+	VkSwapchainKHR oldSwapChain = m_swapChain;
+	SwapChainDesc swapChain;
+	if (!CreateSwapChain(m_physicalDevice, m_device, m_surface, m_settings.m_swapChainImageCount, oldSwapChain, swapChain))
 	{
-		if (m_swapChainImages[i].m_imageView != VK_NULL_HANDLE)
+		if (swapChain.m_swapChain != VK_NULL_HANDLE)
 		{
-			vkDestroyImageView(m_device, m_swapChainImages[i].m_imageView, nullptr);
-			m_swapChainImages[i].m_imageView = VK_NULL_HANDLE;
+			retireSwapChain(swapChain.m_swapChain, swapChain.m_images);
 		}
-	}
-	m_swapChainImages.clear();
-
-	VkSurfaceCapabilitiesKHR surfaceCapabilities;
-	result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &surfaceCapabilities);
-	if (result != VK_SUCCESS)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface capabilities failed");
-		return false;
-	}
-	if (0 == (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
-	{
-		return false;
-	}
-	uint32_t formatCount;
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, m_surface, &formatCount, nullptr);
-	if (result != VK_SUCCESS || formatCount == 0)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface formats failed");
-		return false;
-	}
-	std::vector<VkSurfaceFormatKHR> formats(formatCount);
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(m_physicalDevice, m_surface, &formatCount, formats.data());
-	if (result != VK_SUCCESS)
-	{
-		QMessageBox::critical(nullptr, "error", "get surface formats failed");
+		reportError("create swapchain failed");
 		return false;
 	}
-	uint32_t presentModeCount;
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &presentModeCount, nullptr);
-	if (result != VK_SUCCESS || presentModeCount == 0)
+	if (swapChain.m_swapChain == VK_NULL_HANDLE)
 	{
-		QMessageBox::critical(nullptr, "error", "get surface present modes failed");
-		return false;
+		m_swapChainDirty = true;
+		return true;
 	}
-	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &presentModeCount, presentModes.data());
-	if (result != VK_SUCCESS)
+	if (oldSwapChain != VK_NULL_HANDLE)
 	{
-		QMessageBox::critical(nullptr, "error", "get surface present modes failed");
-		return false;
+		retireSwapChain(oldSwapChain, m_swapChainImages);
 	}
+	m_swapChain = swapChain.m_swapChain;
+	m_swapChainFormat = swapChain.m_format;
+	m_swapChainExtent = swapChain.m_extent;
+	m_swapChainImages.swap(swapChain.m_images);
+	return true;
+}
 
-	uint32_t desiredImageCount = 3;
-	desiredImageCount = min(desiredImageCount, surfaceCapabilities.maxImageCount);
-	desiredImageCount = max(desiredImageCount, surfaceCapabilities.minImageCount);
-
-	VkSurfaceFormatKHR desiredFormat = formats[0];
-	for (VkSurfaceFormatKHR &format : formats) 
-	{
-		if (format.format == VK_FORMAT_R8G8B8A8_UNORM) 
-		{
-			desiredFormat = format;
-			break;
-		}
-	}
-	if (desiredFormat.format == VK_FORMAT_UNDEFINED)
-	{
-		desiredFormat.format = VK_FORMAT_R8G8B8A8_UNORM;
-		desiredFormat.colorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
-	}
-	VkExtent2D desiredExtent = surfaceCapabilities.currentExtent;
-	desiredExtent.width = min(desiredExtent.width, surfaceCapabilities.maxImageExtent.width);
-	desiredExtent.width = max(desiredExtent.width, surfaceCapabilities.minImageExtent.width);
-	desiredExtent.height = min(desiredExtent.height, surfaceCapabilities.maxImageExtent.height);
-	desiredExtent.height = max(desiredExtent.height, surfaceCapabilities.minImageExtent.height);
-	if (0 == desiredExtent.width || 0 == desiredExtent.height)
+bool Tutorial03::createOffscreenTargets()
+{
+	VkResult result;
+	retireSwapChain(VK_NULL_HANDLE, m_swapChainImages);
+	m_swapChainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	m_swapChainExtent = { m_settings.m_width, m_settings.m_height };
+	if (0 == m_swapChainExtent.width || 0 == m_swapChainExtent.height)
 	{
+		m_swapChainDirty = true;
 		return true;
 	}
 
-	VkImageUsageFlags desiredUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-	
-	VkSurfaceTransformFlagBitsKHR desiredTransform = surfaceCapabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR : surfaceCapabilities.currentTransform;
-	
-	VkPresentModeKHR desiredPresentMode = presentModes[0];
-	for (VkPresentModeKHR presentMode : presentModes)
+	m_swapChainImages.resize(m_settings.m_framesInFlight);
+	for (SwapchainImage& image : m_swapChainImages)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		VkImageCreateInfo imageCreateInfo =
 		{
-			desiredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
-			break;
+			VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_IMAGE_TYPE_2D,
+			m_swapChainFormat,
+			{
+				m_swapChainExtent.width,
+				m_swapChainExtent.height,
+				1,
+			},
+			1,
+			1,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_SHARING_MODE_EXCLUSIVE,
+			0,
+			nullptr,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &image.m_image);
+		if (result != VK_SUCCESS)
+		{
+			return false;
 		}
-		else if (presentMode == VK_PRESENT_MODE_FIFO_KHR)
+		if (!AllocateImageMemory(m_device, m_physicalDevice, m_memoryTracker, image.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, RenderTargetMemory, image.m_deviceMemory))
 		{
-			desiredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+			return false;
+		}
+		if (!CreateImageView(m_device, image.m_image, m_swapChainFormat, image.m_imageView))
+		{
+			return false;
 		}
 	}
-	VkSwapchainKHR oldSwapChain = m_swapChain;
-
-	VkSwapchainCreateInfoKHR swapChainCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-		nullptr,
-		0,
-		m_surface,
-		desiredImageCount,
-		desiredFormat.format,
-		desiredFormat.colorSpace,
-		desiredExtent,
-		1,
-		desiredUsage,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-		desiredTransform,
-		VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		desiredPresentMode,
-		VK_TRUE,
-		oldSwapChain,
-	};
-
-	result = vkCreateSwapchainKHR(m_device, &swapChainCreateInfo, nullptr, &m_swapChain);
-	if (result != VK_SUCCESS)
-	{
-		m_swapChain = VK_NULL_HANDLE;
-		return false;
-	}
-	m_swapChainFormat = desiredFormat.format;
-	m_swapChainExtent = desiredExtent;
+	return true;
+}
 
-	if (oldSwapChain != VK_NULL_HANDLE)
+bool Tutorial03::createReadbackRing()
+{
+	if (!m_settings.m_readback || 0 == m_swapChainExtent.width || 0 == m_swapChainExtent.height || m_readbackRing.matches(m_swapChainFormat, m_swapChainExtent))
 	{
-		vkDestroySwapchainKHR(m_device, oldSwapChain, nullptr);
+		return true;
 	}
-
-	uint32_t imageCount = 0;
-	result = vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-	if (result != VK_SUCCESS || imageCount == 0)
+	if (!m_settings.m_captureDirectory.empty())
 	{
-		return false;
+		std::error_code errorCode;
+		std::filesystem::create_directories(m_settings.m_captureDirectory, errorCode);
 	}
-	std::vector<VkImage> images(imageCount);
-	result = vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, images.data());
-	if (result != VK_SUCCESS)
+	// the frame waited for at the start of draw is framesInFlight behind, so one slot per frame in flight never runs dry
+	if (!m_readbackRing.init(m_device, m_physicalDevice, m_memoryTracker, m_settings.m_framesInFlight, m_swapChainFormat, m_swapChainExtent, [this](std::function<void()> deleter) { retire(deleter); }))
 	{
+		reportError("create readback ring failed");
 		return false;
 	}
-	m_swapChainImages.resize(imageCount);
-	for (uint32_t i = 0; i < imageCount; ++i)
-	{
-		m_swapChainImages[i].m_image = images[i];
-	}
-	for (uint32_t i = 0; i < imageCount; ++i)
+	return true;
+}
+
+void Tutorial03::writeCapture(const ReadbackFrame& frame)
+{
+	if (m_settings.m_captureDirectory.empty())
 	{
-		VkImageViewCreateInfo imageViewCreateInfo =
-		{
-			VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			nullptr,
-			0,
-			images[i],
-			VK_IMAGE_VIEW_TYPE_2D,
-			m_swapChainFormat,
-			{
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			},
-			{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0,
-				1,
-				0,
-				1,
-			},
-		};
-		result = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_swapChainImages[i].m_imageView);
-		if (result != VK_SUCCESS)
-		{
-			return false;
-		}
+		return;
 	}
-	return true;
+	std::string fileName = std::to_string(frame.m_frameNumber);
+	fileName = "frame_" + std::string(fileName.size() < 6 ? 6 - fileName.size() : 0, '0') + fileName + ".ppm";
+	WritePpm((std::filesystem::path(m_settings.m_captureDirectory) / fileName).string(), frame);
 }
 
 bool Tutorial03::createRenderPass()
 {
 	VkResult result;
-	VkAttachmentDescription attachmentDescription =
+	bool multisample = m_sampleCount != VK_SAMPLE_COUNT_1_BIT;
+	// with msaa the samples are cleared, resolved at the end of the subpass and never stored
+	VkAttachmentDescription colorAttachmentDescription =
 	{
 		0,
 		m_swapChainFormat,
-		VK_SAMPLE_COUNT_1_BIT,
+		m_sampleCount,
 		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		multisample ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+	VkAttachmentDescription resolveAttachmentDescription =
+	{
+		0,
+		m_swapChainFormat,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 		VK_ATTACHMENT_STORE_OP_STORE,
 		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 		VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+	// depth only lives for the subpass, nothing reads it afterwards
+	VkAttachmentDescription depthAttachmentDescription =
+	{
+		0,
+		m_depthFormat,
+		m_sampleCount,
+		VK_ATTACHMENT_LOAD_OP_CLEAR,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	};
+	std::vector<VkAttachmentDescription> attachmentDescriptions;
+	attachmentDescriptions.push_back(colorAttachmentDescription);
+	if (multisample)
+	{
+		attachmentDescriptions.push_back(resolveAttachmentDescription);
+	}
+	VkAttachmentReference depthAttachmentReference =
+	{
+		static_cast<uint32_t>(attachmentDescriptions.size()),
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
 	};
+	if (m_depthFormat != VK_FORMAT_UNDEFINED)
+	{
+		attachmentDescriptions.push_back(depthAttachmentDescription);
+	}
 
 	VkAttachmentReference attachmentReference =
 	{
@@ -644,6 +895,12 @@ bool Tutorial03::createRenderPass()
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 	};
 
+	VkAttachmentReference resolveAttachmentReference =
+	{
+		1,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
 	VkSubpassDescription subpassDescription =
 	{
 		0,
@@ -652,45 +909,24 @@ bool Tutorial03::createRenderPass()
 		nullptr,
 		1,
 		&attachmentReference,
-		nullptr,
-		nullptr,
+		multisample ? &resolveAttachmentReference : nullptr,
+		m_depthFormat != VK_FORMAT_UNDEFINED ? &depthAttachmentReference : nullptr,
 		0,
 		nullptr,
 	};
 
-	VkSubpassDependency subpassDependencies[]=
-	{
-		{
-			VK_SUBPASS_EXTERNAL,
-			0,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_DEPENDENCY_BY_REGION_BIT,
-		},
-		{
-			0,
-			VK_SUBPASS_EXTERNAL,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_DEPENDENCY_BY_REGION_BIT,
-		},
-	};
-
+	// layout transitions and dependencies on the attachment come from the render graph
 	VkRenderPassCreateInfo renderPassCreateInfo =
 	{
 		VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 		nullptr,
 		0,
-		1,
-		&attachmentDescription,
+		static_cast<uint32_t>(attachmentDescriptions.size()),
+		attachmentDescriptions.data(),
 		1,
 		&subpassDescription,
-		sizeof(subpassDependencies)/sizeof(subpassDependencies[0]),
-		subpassDependencies,
+		0,
+		nullptr,
 	};
 
 	VkRenderPass renderPass;
@@ -711,7 +947,7 @@ bool Tutorial03::createRenderingResources()
 	{
 		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
 		nullptr,
-		0,
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
 		m_graphicsQueueFamilyIndex
 	};
 
@@ -722,137 +958,82 @@ bool Tutorial03::createRenderingResources()
 		return false;
 	}
 
-	VkCommandBuffer commandBuffers[rendering_resource_count];
+	m_renderingResources.resize(m_settings.m_framesInFlight);
+	if (!CreateRenderingResources(m_device, m_graphicsCommandPool, m_renderingResources))
+	{
+		QMessageBox::critical(nullptr, "error", "create rendering resources failed");
+		return false;
+	}
+
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo =
 	{
 		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 		nullptr,
 		m_graphicsCommandPool,
 		VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		rendering_resource_count,
+		1,
 	};
-	result = vkAllocateCommandBuffers(m_device, &commandBufferAllocateInfo, commandBuffers);
+	result = vkAllocateCommandBuffers(m_device, &commandBufferAllocateInfo, &m_uploadCommandBuffer);
 	if (result != VK_SUCCESS)
 	{
 		QMessageBox::critical(nullptr, "error", "allocate command buffers failed");
 		return false;
 	}
 
-	for (uint32_t i = 0; i < rendering_resource_count; ++i)
-	{
-		m_renderingResources[i].m_commandBuffer = commandBuffers[i];
-	}
-
-	VkSemaphoreCreateInfo semaphoreCreateInfo =
+	VkFenceCreateInfo fenceCreateInfo =
 	{
-		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
 		nullptr,
 		0
 	};
-	for (uint32_t i = 0; i < rendering_resource_count; ++i)
-	{
-		vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_renderingResources[i].m_imageAvailableSemaphore);
-		vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_renderingResources[i].m_renderingFinishedSemaphore);
-	}
+	vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_uploadFence);
 
-	VkFenceCreateInfo fenceCreateInfo =
+	if (m_timelineSemaphoreSupported)
 	{
-		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		nullptr, 
-		VK_FENCE_CREATE_SIGNALED_BIT
-	};
-	for (uint32_t i = 0; i < rendering_resource_count; ++i)
-	{
-		vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_renderingResources[i].m_fence);
+		VkSemaphoreTypeCreateInfoKHR semaphoreTypeCreateInfo =
+		{
+			VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+			nullptr,
+			VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+			m_submittedSerial,
+		};
+		VkSemaphoreCreateInfo timelineSemaphoreCreateInfo =
+		{
+			VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			&semaphoreTypeCreateInfo,
+			0
+		};
+		result = vkCreateSemaphore(m_device, &timelineSemaphoreCreateInfo, nullptr, &m_timelineSemaphore);
+		if (result != VK_SUCCESS)
+		{
+			QMessageBox::critical(nullptr, "error", "create timeline semaphore failed");
+			return false;
+		}
 	}
-	return true;
-}
 
-
-VkShaderModule Tutorial03::createShaderModule(const char* fileName)
-{
-	VkResult result;
-	std::vector<char> shaderCode = GetBinaryFileContents(fileName);
-	if (shaderCode.empty())
+	m_uploadProfilerSlot = static_cast<uint32_t>(m_renderingResources.size());
+	if (!m_gpuProfiler.init(m_device, m_physicalDevice, m_graphicsQueueFamilyIndex, m_uploadProfilerSlot + 1, m_vkGetCalibratedTimestampsEXT, m_hostTimeDomain))
 	{
-		return VK_NULL_HANDLE;
+		qDebug() << "gpu timestamps not supported, profiler disabled";
 	}
-
-	VkShaderModuleCreateInfo shaderModuleCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		nullptr,
-		0,
-		shaderCode.size(),
-		(const uint32_t*)shaderCode.data(),
-	};
-
-	VkShaderModule shaderModule;
-	result = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule);
-	if (result != VK_SUCCESS)
+	else if (m_pipelineStatisticsQuery && !m_gpuProfiler.initPipelineStatistics())
 	{
-		return VK_NULL_HANDLE;
+		qDebug() << "create pipeline statistics query pool failed";
 	}
-	return shaderModule;
+	return true;
 }
 
 
 bool Tutorial03::createStagingBuffer()
 {
-	VkResult result;
+	TRACE_FUNCTION();
 	const uint32_t stagingBufferSize = 1 * 1024 * 1024;
+	const uint32_t max_uniform_stride = 256;
 	m_stagingBuffer.m_size = stagingBufferSize;
+	m_stagingBuffer.m_size = max(m_stagingBuffer.m_size, m_settings.m_quadCount * 4 * m_vertexLayout.vertexSize());
+	m_stagingBuffer.m_size = max(m_stagingBuffer.m_size, m_settings.m_materialCount * max_uniform_stride);
 
-	VkBufferCreateInfo stagingBufferCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		nullptr,
-		0,
-		m_stagingBuffer.m_size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-	};
-
-	result = vkCreateBuffer(m_device, &stagingBufferCreateInfo, nullptr, &m_stagingBuffer.m_buffer);
-	if (result != VK_SUCCESS)
-	{
-		return false;
-	}
-
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
-
-	VkMemoryRequirements memoryRequirements;
-	vkGetBufferMemoryRequirements(m_device, m_stagingBuffer.m_buffer, &memoryRequirements);
-
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
-	{
-		if (memoryRequirements.memoryTypeBits & 1 << i
-			&&
-			memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
-		{
-			VkMemoryAllocateInfo allocateInfo =
-			{
-				VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-				nullptr,
-				m_stagingBuffer.m_size,
-				i
-			};
-			result = vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_stagingBuffer.m_deviceMemory);
-			if (result == VK_SUCCESS)
-			{
-				break;
-			}
-		}
-	}
-	if (m_stagingBuffer.m_deviceMemory == VK_NULL_HANDLE)
-	{
-		return false;
-	}
-	result = vkBindBufferMemory(m_device, m_stagingBuffer.m_buffer, m_stagingBuffer.m_deviceMemory, 0);
-	if (result != VK_SUCCESS)
+	if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_stagingBuffer.m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, StagingMemory, m_stagingBuffer.m_buffer, m_stagingBuffer.m_deviceMemory))
 	{
 		return false;
 	}
@@ -861,7 +1042,12 @@ bool Tutorial03::createStagingBuffer()
 
 bool Tutorial03::createTexture()
 {
-	VkResult result;
+	TRACE_FUNCTION();
+	for (Texture& texture : m_textures)
+	{
+		retireTexture(texture);
+	}
+	m_textures.assign(m_settings.m_textureCount, Texture());
 
 	std::filesystem::path path(QCoreApplication::applicationDirPath().toStdString());
 	path = path.parent_path() / "assets/texture.png";
@@ -890,96 +1076,119 @@ bool Tutorial03::createTexture()
 
 	int imageSize = (width) * (height) * (req_comp <= 0 ? components : req_comp);
 
-	VkImageCreateInfo imageCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		nullptr,
-		0,
-		VK_IMAGE_TYPE_2D,
-		VK_FORMAT_R8G8B8A8_UNORM,
-		{
-			width,
-			height,
-			1,
-		},
-		1,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-	};
-
-	result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &m_texture.m_image);
-	if (result != VK_SUCCESS)
+	if (!WriteMemory(m_device, m_stagingBuffer.m_deviceMemory, imageData, imageSize))
 	{
 		return false;
 	}
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(m_device, m_texture.m_image, &memoryRequirements);
-
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
 
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	for (Texture& texture : m_textures)
 	{
-		if (memoryRequirements.memoryTypeBits & 1 << i
-			&&
-			memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+		if (!createTextureImage(texture, width, height))
 		{
-			VkMemoryAllocateInfo allocateInfo =
-			{
-				VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-				nullptr,
-				memoryRequirements.size,
-				i
-			};
-			result = vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_texture.m_deviceMemory);
-			if (result == VK_SUCCESS)
-			{
-				break;
-			}
+			return false;
 		}
 	}
-	if (m_texture.m_deviceMemory == VK_NULL_HANDLE)
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo =
 	{
-		return false;
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		nullptr,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		nullptr,
+	};
+
+	VkCommandBuffer commandBuffer = m_uploadCommandBuffer;
+	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	m_gpuProfiler.beginFrame(commandBuffer, m_uploadProfilerSlot);
+	uint32_t uploadScope = m_gpuProfiler.beginScope(commandBuffer, "upload texture");
+
+	// every texture is copied in one pass so their layout transitions share one barrier before and after
+	m_uploadGraph.reset();
+	uint32_t stagingResource = m_uploadGraph.importBuffer("staging", m_stagingBuffer.m_buffer, 0, imageSize, UsageNone, UsageNone);
+	uint32_t copyPass = m_uploadGraph.addPass("copy textures", [&](VkCommandBuffer commandBuffer) {
+		VkBufferImageCopy bufferImageCopy =
+		{
+			0,
+			0,
+			0,
+			{
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				0,
+				0,
+				1,
+			},
+			{
+				0,
+				0,
+				0,
+			},
+			{
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height),
+				1,
+			},
+		};
+		for (const Texture& texture : m_textures)
+		{
+			vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffer.m_buffer, texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+		}
+	});
+	m_uploadGraph.read(copyPass, stagingResource, UsageTransferSrc);
+	for (const Texture& texture : m_textures)
+	{
+		uint32_t textureResource = m_uploadGraph.importImage("texture", texture.m_image, VK_FORMAT_R8G8B8A8_UNORM, UsageNone, UsageShaderRead);
+		m_uploadGraph.write(copyPass, textureResource, UsageTransferDst);
 	}
-	result = vkBindImageMemory(m_device, m_texture.m_image, m_texture.m_deviceMemory, 0);
-	if (result != VK_SUCCESS)
+	if (!m_uploadGraph.compile())
 	{
 		return false;
 	}
-	VkImageViewCreateInfo imageViewCreateInfo =
+	m_uploadGraph.execute(commandBuffer);
+	m_gpuProfiler.endScope(commandBuffer, uploadScope);
+
+	vkEndCommandBuffer(commandBuffer);
+	return submitAndWait(commandBuffer);
+}
+
+bool Tutorial03::createTextureImage(Texture& texture, uint32_t width, uint32_t height)
+{
+	VkResult result;
+	VkImageCreateInfo imageCreateInfo =
 	{
-		VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		nullptr,
 		0,
-		m_texture.m_image,
-		VK_IMAGE_VIEW_TYPE_2D,
+		VK_IMAGE_TYPE_2D,
 		VK_FORMAT_R8G8B8A8_UNORM,
 		{
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-			VK_COMPONENT_SWIZZLE_IDENTITY,
-		},
-		{
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			0,
+			width,
+			height,
 			1,
-			0,
-			1
 		},
+		1,
+		1,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_SHARING_MODE_EXCLUSIVE,
+		0,
+		nullptr,
+		VK_IMAGE_LAYOUT_UNDEFINED,
 	};
-	result = vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_texture.m_imageView);
+
+	result = vkCreateImage(m_device, &imageCreateInfo, nullptr, &texture.m_image);
 	if (result != VK_SUCCESS)
 	{
 		return false;
 	}
+	if (!AllocateImageMemory(m_device, m_physicalDevice, m_memoryTracker, texture.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, TextureMemory, texture.m_deviceMemory))
+	{
+		return false;
+	}
+	if (!CreateImageView(m_device, texture.m_image, VK_FORMAT_R8G8B8A8_UNORM, texture.m_imageView))
+	{
+		return false;
+	}
 
 	VkSamplerCreateInfo samplerCreateInfo =
 	{
@@ -1002,29 +1211,64 @@ bool Tutorial03::createTexture()
 		VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
 		VK_FALSE,
 	};
-	result = vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_texture.m_sampler);
+	result = vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &texture.m_sampler);
 	if (result != VK_SUCCESS)
 	{
 		return false;
 	}
 
-	void* mappedPtr;
-	result = vkMapMemory(m_device, m_stagingBuffer.m_deviceMemory, 0, imageSize, 0, &mappedPtr);
-	if (result != VK_SUCCESS)
+	return true;
+}
+
+bool Tutorial03::createVertexBuffer()
+{
+	TRACE_FUNCTION();
+	m_vertexBuffer.m_mappedData = nullptr;
+	m_vertexStagingBuffer.m_mappedData = nullptr;
+	retireBuffer(m_vertexBuffer.m_buffer, m_vertexBuffer.m_deviceMemory);
+	retireBuffer(m_vertexStagingBuffer.m_buffer, m_vertexStagingBuffer.m_deviceMemory);
+
+	// dynamic vertices get one region per frame in flight so the cpu never writes what the gpu reads
+	uint32_t regionCount = m_settings.m_dynamicVertices ? static_cast<uint32_t>(m_renderingResources.size()) : 1u;
+	m_vertexBuffer.m_size = m_settings.m_quadCount * 4 * m_vertexLayout.vertexSize();
+	VkMemoryPropertyFlags preferredFlags = m_settings.m_directWrite ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0;
+	if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_vertexBuffer.m_size * regionCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferredFlags, VertexMemory, m_vertexBuffer.m_buffer, m_vertexBuffer.m_deviceMemory, &m_vertexBuffer.m_memoryFlags))
 	{
 		return false;
 	}
-	memcpy(mappedPtr, imageData, imageSize);
-	VkMappedMemoryRange mappedMemoryRange =
+
+	if (m_vertexBuffer.m_memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
 	{
-		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		nullptr,
-		m_stagingBuffer.m_deviceMemory,
-		0,
-		imageSize,
-	};
-	vkFlushMappedMemoryRanges(m_device, 1, &mappedMemoryRange);
-	vkUnmapMemory(m_device, m_stagingBuffer.m_deviceMemory);
+		if (!MapMemory(m_device, m_vertexBuffer.m_deviceMemory, m_vertexBuffer.m_mappedData))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < regionCount; ++i)
+		{
+			WriteQuadVertices(m_vertexLayout, static_cast<char*>(m_vertexBuffer.m_mappedData) + i * m_vertexBuffer.m_size, m_settings.m_quadCount, m_settings.m_quadLayers, 0.0f);
+		}
+		FlushMemory(m_device, m_vertexBuffer.m_deviceMemory, m_vertexBuffer.m_memoryFlags);
+		qDebug() << "vertex buffer" << "direct write";
+		return true;
+	}
+	qDebug() << "vertex buffer" << "staging copy";
+
+	if (m_settings.m_dynamicVertices)
+	{
+		m_vertexStagingBuffer.m_size = m_vertexBuffer.m_size * regionCount;
+		if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_vertexStagingBuffer.m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, StagingMemory, m_vertexStagingBuffer.m_buffer, m_vertexStagingBuffer.m_deviceMemory, &m_vertexStagingBuffer.m_memoryFlags)
+			|| !MapMemory(m_device, m_vertexStagingBuffer.m_deviceMemory, m_vertexStagingBuffer.m_mappedData))
+		{
+			return false;
+		}
+	}
+
+	std::vector<char> vertexData(m_vertexBuffer.m_size);
+	WriteQuadVertices(m_vertexLayout, vertexData.data(), m_settings.m_quadCount, m_settings.m_quadLayers, 0.0f);
+	if (!WriteMemory(m_device, m_stagingBuffer.m_deviceMemory, vertexData.data(), m_vertexBuffer.m_size))
+	{
+		return false;
+	}
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo =
 	{
@@ -1034,190 +1278,223 @@ bool Tutorial03::createTexture()
 		nullptr,
 	};
 
-	VkCommandBuffer commandBuffer = m_renderingResources[0].m_commandBuffer;
-	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	VkCommandBuffer commandBuffer = m_uploadCommandBuffer;
 
-	VkImageSubresourceRange imageSubresourceRange =
-	{
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		0,
-		1,
-		0,
-		1
-	};
-	VkImageMemoryBarrier imageMemoryBarrier =
+	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	m_gpuProfiler.beginFrame(commandBuffer, m_uploadProfilerSlot);
+	uint32_t uploadScope = m_gpuProfiler.beginScope(commandBuffer, "upload vertices");
+
+	m_uploadGraph.reset();
+	uint32_t stagingResource = m_uploadGraph.importBuffer("staging", m_stagingBuffer.m_buffer, 0, m_vertexBuffer.m_size, UsageNone, UsageNone);
+	uint32_t vertexResource = m_uploadGraph.importBuffer("vertices", m_vertexBuffer.m_buffer, 0, VK_WHOLE_SIZE, UsageNone, UsageVertexBuffer);
+	uint32_t copyPass = m_uploadGraph.addPass("copy vertices", [&](VkCommandBuffer commandBuffer) {
+		std::vector<VkBufferCopy> bufferCopies;
+		for (uint32_t i = 0; i < regionCount; ++i)
+		{
+			VkBufferCopy bufferCopy =
+			{
+				0,
+				i * m_vertexBuffer.m_size,
+				m_vertexBuffer.m_size,
+			};
+			bufferCopies.push_back(bufferCopy);
+		}
+		vkCmdCopyBuffer(commandBuffer, m_stagingBuffer.m_buffer, m_vertexBuffer.m_buffer, regionCount, bufferCopies.data());
+	});
+	m_uploadGraph.read(copyPass, stagingResource, UsageTransferSrc);
+	m_uploadGraph.write(copyPass, vertexResource, UsageTransferDst);
+	if (!m_uploadGraph.compile())
 	{
-		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		nullptr,
-		0,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_QUEUE_FAMILY_IGNORED,
-		VK_QUEUE_FAMILY_IGNORED,
-		m_texture.m_image,
-		imageSubresourceRange,
-	};
-
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		return false;
+	}
+	m_uploadGraph.execute(commandBuffer);
+	m_gpuProfiler.endScope(commandBuffer, uploadScope);
+	vkEndCommandBuffer(commandBuffer);
+	return submitAndWait(commandBuffer);
+}
 
-	VkBufferImageCopy bufferImageCopy =
+bool Tutorial03::streamVertices(uint32_t resourceIndex, VkDeviceSize& vertexOffset)
+{
+	TRACE_FUNCTION();
+	float phase = 0.05f * static_cast<float>(++m_streamedFrames);
+	vertexOffset = static_cast<VkDeviceSize>(resourceIndex) * m_vertexBuffer.m_size;
+	m_streamedVertexBytes += m_vertexBuffer.m_size;
+	if (m_vertexBuffer.m_mappedData != nullptr)
+	{
+		WriteQuadVertices(m_vertexLayout, static_cast<char*>(m_vertexBuffer.m_mappedData) + vertexOffset, m_settings.m_quadCount, m_settings.m_quadLayers, phase);
+		FlushMemory(m_device, m_vertexBuffer.m_deviceMemory, m_vertexBuffer.m_memoryFlags);
+		return true;
+	}
+	if (m_vertexStagingBuffer.m_mappedData == nullptr)
 	{
-		0,
-		0,
-		0,
-		{
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			0,
-			0,
-			1,
-		},
-		{
-			0,
-			0,
-			0,
-		},
-		{
-			width,
-			height,
-			1,
-		},
-	};
+		return false;
+	}
+	WriteQuadVertices(m_vertexLayout, static_cast<char*>(m_vertexStagingBuffer.m_mappedData) + vertexOffset, m_settings.m_quadCount, m_settings.m_quadLayers, phase);
+	FlushMemory(m_device, m_vertexStagingBuffer.m_deviceMemory, m_vertexStagingBuffer.m_memoryFlags);
+	return true;
+}
 
-	vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffer.m_buffer, m_texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1, &bufferImageCopy);
+void Tutorial03::buildDrawList(VkDeviceSize vertexOffset)
+{
+	TRACE_FUNCTION();
+	m_drawBindings.m_pipelineLayout = m_pipelineLayout;
+	m_drawBindings.m_pipelines = { m_pipeline, m_meshPipeline };
+	m_drawBindings.m_descriptorSets = m_descriptorSet.m_descriptorSets;
+	m_drawBindings.m_vertexBindingCount = m_vertexLayout.bindingCount();
+	m_drawBindings.m_vertexBuffers.clear();
+	m_drawBindings.m_vertexOffsets.clear();
+	for (uint32_t binding = 0; binding < m_vertexLayout.bindingCount(); ++binding)
+	{
+		m_drawBindings.m_vertexBuffers.push_back(m_vertexBuffer.m_buffer);
+		m_drawBindings.m_vertexOffsets.push_back(vertexOffset + VertexStreamOffset(m_vertexLayout, m_settings.m_quadCount * 4, binding));
+	}
+	for (uint32_t binding = 0; binding < m_vertexLayout.bindingCount(); ++binding)
+	{
+		m_drawBindings.m_vertexBuffers.push_back(m_meshVertexBuffer.m_buffer);
+		m_drawBindings.m_vertexOffsets.push_back(VertexStreamOffset(m_vertexLayout, m_meshStatistics.m_vertexCount, binding));
+	}
+	m_drawBindings.m_indexBuffer = m_meshIndexBuffer.m_buffer;
+	// the prepass draws the same list, its pipelines only read the position stream
+	m_prepassBindings = m_drawBindings;
+	m_prepassBindings.m_pipelines = m_prepassPipelines;
+
+	// the mesh takes the place of the quads, as one draw in the order it was optimised for
+	m_drawList.reset();
+	if (m_meshStatistics.m_triangleCount > 0)
+	{
+		m_drawList.addIndexed(DrawList::makeKey(1, 0, 1, 0.0f), 1, 0, 1, 0, m_meshStatistics.m_triangleCount * 3, 0);
+		m_drawList.sort();
+		return;
+	}
 
-	VkImageMemoryBarrier imageMemoryBarrier2 =
+	// opaque quads go nearest first when depth tested, otherwise keys only group materials and keep the submission order within one
+	bool frontToBack = m_depthFormat != VK_FORMAT_UNDEFINED && m_settings.m_frontToBack;
+	for (uint32_t quad = 0; quad < m_settings.m_quadCount; ++quad)
 	{
-		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		nullptr,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_QUEUE_FAMILY_IGNORED,
-		VK_QUEUE_FAMILY_IGNORED,
-		m_texture.m_image,
-		imageSubresourceRange,
-	};
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier2);
+		uint32_t material = quad % m_settings.m_materialCount;
+		float depth = frontToBack ? QuadDepth(quad, m_settings.m_quadCount, m_settings.m_quadLayers) : 0.0f;
+		m_drawList.add(DrawList::makeKey(0, material, 0, depth, frontToBack), 0, material, 0, quad * 4, 4);
+	}
+	m_drawList.sort();
+}
 
-	vkEndCommandBuffer(commandBuffer);
-	VkSubmitInfo submitInfo =
-	{
-		VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		nullptr,
-		0,
-		nullptr,
-		0,
-		1,
-		&commandBuffer,
-		0,
-		nullptr,
-	};
-	result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+bool Tutorial03::createStreamBuffer()
+{
+	if (!m_settings.m_debugOverlay)
 	{
-		return false;
+		return true;
 	}
-	vkDeviceWaitIdle(m_device);
-	return true;
+	m_overlayFrameTimes.assign(overlay_frame_count, 0.0f);
+	return m_streamBuffer.init(m_device, m_physicalDevice, m_memoryTracker, stream_region_size, static_cast<uint32_t>(m_renderingResources.size()),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, [this](std::function<void()> deleter) { retire(deleter); });
 }
 
-bool Tutorial03::createVertexBuffer()
+void Tutorial03::buildOverlay(uint32_t resourceIndex, float frameTime)
 {
-	VkResult result;
-	VertexData vertexData[] =
-	{
-	  {
-		-0.7f, -0.7f, 0.0f, 1.0f,
-		-0.1f, -0.1f,
-	  },
-	  {
-		-0.7f, 0.7f, 0.0f, 1.0f,
-		-0.1f, 1.1f,
-	  },
-	  {
-		0.7f, -0.7f, 0.0f, 1.0f,
-		1.1f, -0.1f,
-	  },
-	  {
-		0.7f, 0.7f, 0.0f, 1.0f,
-		1.1f, 1.1f,
-	  }
-	};
+	TRACE_FUNCTION();
+	m_overlayFrameTimes[m_overlayFrame++ % overlay_frame_count] = frameTime;
+	m_streamBuffer.beginFrame(resourceIndex);
+	m_overlayBatcher.begin();
+
+	// a bar per recent frame along the bottom, 33ms fills the strip
+	m_overlayBatcher.setState(overlay_triangles, 0);
+	float barWidth = 1.8f / overlay_frame_count;
+	for (uint32_t i = 0; i < overlay_frame_count; ++i)
+	{
+		float milliseconds = m_overlayFrameTimes[(m_overlayFrame + i) % overlay_frame_count];
+		float height = min(milliseconds / 33.3f, 1.0f) * 0.2f;
+		float left = -0.9f + barWidth * i;
+		m_overlayBatcher.quad(left, 0.95f - height, left + barWidth * 0.8f, 0.95f, 0.0f);
+	}
+
+	// every quad outlined with its own texture, the lines collapse into one draw per texture
+	for (uint32_t quad = 0; quad < m_settings.m_quadCount; ++quad)
+	{
+		float left, top, cellSize;
+		QuadRect(quad, m_settings.m_quadCount, m_settings.m_quadLayers, left, top, cellSize);
+		float right = left + cellSize;
+		float bottom = top + cellSize;
+		m_overlayBatcher.setState(overlay_lines, quad % m_settings.m_materialCount);
+		m_overlayBatcher.line(left, top, right, top, 0.0f);
+		m_overlayBatcher.line(right, top, right, bottom, 0.0f);
+		m_overlayBatcher.line(right, bottom, left, bottom, 0.0f);
+		m_overlayBatcher.line(left, bottom, left, top, 0.0f);
+	}
+
+	m_overlayDrawList.reset();
+	m_overlayBatcher.end(m_streamBuffer, 0, m_overlayDrawList);
+	m_overlayDrawList.sort();
+	m_streamBuffer.endFrame();
+
+	m_overlayBindings.m_pipelineLayout = m_pipelineLayout;
+	m_overlayBindings.m_pipelines = m_overlayPipelines;
+	m_overlayBindings.m_descriptorSets = m_descriptorSet.m_descriptorSets;
+	m_overlayBindings.m_vertexBuffers.assign(1, m_streamBuffer.buffer());
+	m_overlayBindings.m_vertexOffsets.assign(1, 0);
+	m_overlayBindings.m_indexBuffer = m_streamBuffer.buffer();
+}
 
-	VkMemoryRequirements memoryRequirements;
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
+ImmediateStatistics Tutorial03::overlayStatistics() const
+{
+	return m_overlayBatcher.statistics();
+}
 
-	m_vertexBuffer.m_size = sizeof(vertexData);
-	
-	VkBufferCreateInfo deviceBufferCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		nullptr,
-		0,
-		m_vertexBuffer.m_size,
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-	};
-	result = vkCreateBuffer(m_device, &deviceBufferCreateInfo, nullptr, &m_vertexBuffer.m_buffer);
-	if (result != VK_SUCCESS)
+bool Tutorial03::createMesh()
+{
+	TRACE_FUNCTION();
+	if (m_settings.m_meshFile.empty() && 0 == m_settings.m_meshGridSize)
 	{
-		return false;
+		return true;
 	}
-	vkGetBufferMemoryRequirements(m_device, m_vertexBuffer.m_buffer, &memoryRequirements);
-
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	MeshData mesh;
+	if (m_settings.m_meshFile.empty())
 	{
-		if (memoryRequirements.memoryTypeBits & 1 << i
-			&&
-			memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-		{
-			VkMemoryAllocateInfo allocateInfo =
-			{
-				VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-				nullptr,
-				m_vertexBuffer.m_size,
-				i
-			};
-			result = vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_vertexBuffer.m_deviceMemory);
-			if (result == VK_SUCCESS)
-			{
-				break;
-			}
-		}
+		GenerateGridMesh(m_settings.m_meshGridSize, mesh);
 	}
-	if (m_vertexBuffer.m_deviceMemory == VK_NULL_HANDLE)
+	else if (!LoadObj(m_settings.m_meshFile.c_str(), mesh))
 	{
+		reportError(QString("load mesh %1 failed").arg(m_settings.m_meshFile.c_str()));
 		return false;
 	}
-	result = vkBindBufferMemory(m_device, m_vertexBuffer.m_buffer, m_vertexBuffer.m_deviceMemory, 0);
-	if (result != VK_SUCCESS)
+	else
 	{
-		return false;
+		FitMeshToClipSpace(mesh);
 	}
 
+	// triangles are reordered for the post-transform cache first, then whole clusters for overdraw,
+	// and the vertices last so they are fetched in the order the indices reach them
+	uint32_t vertexCount = static_cast<uint32_t>(mesh.m_vertices.size());
+	m_meshStatistics.m_triangleCount = static_cast<uint32_t>(mesh.m_indices.size() / 3);
+	m_meshStatistics.m_loadedAcmr = ComputeAcmr(mesh.m_indices, vertexCount);
+	OptimizeVertexCache(mesh.m_indices, vertexCount);
+	OptimizeOverdraw(mesh.m_indices, mesh.m_vertices);
+	OptimizeVertexFetch(mesh);
+	vertexCount = static_cast<uint32_t>(mesh.m_vertices.size());
+	m_meshStatistics.m_vertexCount = vertexCount;
+	m_meshStatistics.m_optimizedAcmr = ComputeAcmr(mesh.m_indices, vertexCount);
+	qDebug() << "mesh" << m_meshStatistics.m_vertexCount << "vertices" << m_meshStatistics.m_triangleCount << "triangles"
+		<< "acmr" << m_meshStatistics.m_loadedAcmr << "->" << m_meshStatistics.m_optimizedAcmr;
 
-	void* mappedPtr;
-	result = vkMapMemory(m_device, m_stagingBuffer.m_deviceMemory, 0, m_vertexBuffer.m_size, 0, &mappedPtr);
-	if (result != VK_SUCCESS)
+	m_meshVertexBuffer.m_size = static_cast<uint32_t>(mesh.m_vertices.size()) * m_vertexLayout.vertexSize();
+	m_meshIndexBuffer.m_size = static_cast<uint32_t>(mesh.m_indices.size() * sizeof(uint32_t));
+	if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_meshVertexBuffer.m_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VertexMemory, m_meshVertexBuffer.m_buffer, m_meshVertexBuffer.m_deviceMemory, &m_meshVertexBuffer.m_memoryFlags)
+		|| !CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_meshIndexBuffer.m_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VertexMemory, m_meshIndexBuffer.m_buffer, m_meshIndexBuffer.m_deviceMemory, &m_meshIndexBuffer.m_memoryFlags))
 	{
 		return false;
 	}
-	memcpy(mappedPtr, vertexData, m_vertexBuffer.m_size);
-	VkMappedMemoryRange mappedMemoryRange =
+
+	// meshes can outgrow the shared staging buffer, so they get one of their own for the upload
+	StagingBuffer stagingBuffer;
+	stagingBuffer.m_size = m_meshVertexBuffer.m_size + m_meshIndexBuffer.m_size;
+	if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, stagingBuffer.m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, StagingMemory, stagingBuffer.m_buffer, stagingBuffer.m_deviceMemory, &stagingBuffer.m_memoryFlags)
+		|| !MapMemory(m_device, stagingBuffer.m_deviceMemory, stagingBuffer.m_mappedData))
 	{
-		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		nullptr,
-		m_stagingBuffer.m_deviceMemory,
-		0,
-		m_vertexBuffer.m_size,
-	};
-	vkFlushMappedMemoryRanges(m_device, 1, &mappedMemoryRange);
-	vkUnmapMemory(m_device, m_stagingBuffer.m_deviceMemory);
+		retireBuffer(stagingBuffer.m_buffer, stagingBuffer.m_deviceMemory);
+		return false;
+	}
+	WriteVertexStreams(m_vertexLayout, &mesh.m_vertices[0].x, 0, vertexCount, vertexCount, stagingBuffer.m_mappedData);
+	memcpy(static_cast<char*>(stagingBuffer.m_mappedData) + m_meshVertexBuffer.m_size, mesh.m_indices.data(), m_meshIndexBuffer.m_size);
+	FlushMemory(m_device, stagingBuffer.m_deviceMemory, stagingBuffer.m_memoryFlags);
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo =
 	{
@@ -1227,133 +1504,93 @@ bool Tutorial03::createVertexBuffer()
 		nullptr,
 	};
 
-	VkCommandBuffer commandBuffer = m_renderingResources[0].m_commandBuffer;
+	VkCommandBuffer commandBuffer = m_uploadCommandBuffer;
 
 	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-	
-	VkBufferCopy bufferCopy = 
-	{
-		0,
-		0,
-		m_vertexBuffer.m_size,
-	};
-	vkCmdCopyBuffer(commandBuffer, m_stagingBuffer.m_buffer, m_vertexBuffer.m_buffer, 1, &bufferCopy);
-
-	VkBufferMemoryBarrier bufferMemoryBarrier =
-	{
-		VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-		nullptr,
-		VK_ACCESS_MEMORY_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_QUEUE_FAMILY_IGNORED,
-		VK_QUEUE_FAMILY_IGNORED,
-		m_vertexBuffer.m_buffer,
-		0,
-		VK_WHOLE_SIZE,
-	};
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
+	m_gpuProfiler.beginFrame(commandBuffer, m_uploadProfilerSlot);
+	uint32_t uploadScope = m_gpuProfiler.beginScope(commandBuffer, "upload mesh");
+
+	m_uploadGraph.reset();
+	uint32_t stagingResource = m_uploadGraph.importBuffer("staging", stagingBuffer.m_buffer, 0, stagingBuffer.m_size, UsageNone, UsageNone);
+	uint32_t vertexResource = m_uploadGraph.importBuffer("mesh vertices", m_meshVertexBuffer.m_buffer, 0, VK_WHOLE_SIZE, UsageNone, UsageVertexBuffer);
+	uint32_t indexResource = m_uploadGraph.importBuffer("mesh indices", m_meshIndexBuffer.m_buffer, 0, VK_WHOLE_SIZE, UsageNone, UsageIndexBuffer);
+	uint32_t copyPass = m_uploadGraph.addPass("copy mesh", [&](VkCommandBuffer commandBuffer) {
+		VkBufferCopy vertexCopy =
+		{
+			0,
+			0,
+			m_meshVertexBuffer.m_size,
+		};
+		VkBufferCopy indexCopy =
+		{
+			m_meshVertexBuffer.m_size,
+			0,
+			m_meshIndexBuffer.m_size,
+		};
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer.m_buffer, m_meshVertexBuffer.m_buffer, 1, &vertexCopy);
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer.m_buffer, m_meshIndexBuffer.m_buffer, 1, &indexCopy);
+	});
+	m_uploadGraph.read(copyPass, stagingResource, UsageTransferSrc);
+	m_uploadGraph.write(copyPass, vertexResource, UsageTransferDst);
+	m_uploadGraph.write(copyPass, indexResource, UsageTransferDst);
+	bool uploaded = m_uploadGraph.compile();
+	if (uploaded)
+	{
+		m_uploadGraph.execute(commandBuffer);
+	}
+	m_gpuProfiler.endScope(commandBuffer, uploadScope);
 	vkEndCommandBuffer(commandBuffer);
-	VkSubmitInfo submitInfo =
-	{
-		VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		nullptr,
-		0,
-		nullptr,
-		0,
-		1,
-		&commandBuffer,
-		0,
-		nullptr,
-	};
-	result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		return false;
-	}
-	vkDeviceWaitIdle(m_device);
-	return true;
+	uploaded = uploaded && submitAndWait(commandBuffer);
+	retireBuffer(stagingBuffer.m_buffer, stagingBuffer.m_deviceMemory);
+	return uploaded;
 }
 
-bool Tutorial03::createUniformBuffer()
+MeshStatistics Tutorial03::meshStatistics() const
 {
-	VkResult result;
-	float uniformData[4] =
-	{
-		1,0,0,1,
-	};
-
-	VkMemoryRequirements memoryRequirements;
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
+	return m_meshStatistics;
+}
 
-	m_uniformBuffer.m_size = sizeof(uniformData);
+bool Tutorial03::createUniformBuffer()
+{
+	TRACE_FUNCTION();
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &physicalDeviceProperties);
+	uint32_t alignment = static_cast<uint32_t>(max(physicalDeviceProperties.limits.minUniformBufferOffsetAlignment, 1ull));
+	uint32_t stride = (sizeof(float) * 4 + alignment - 1) / alignment * alignment;
 
-	VkBufferCreateInfo deviceBufferCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		nullptr,
-		0,
-		m_uniformBuffer.m_size,
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_SHARING_MODE_EXCLUSIVE,
-		0,
-		nullptr,
-	};
-	result = vkCreateBuffer(m_device, &deviceBufferCreateInfo, nullptr, &m_uniformBuffer.m_buffer);
-	if (result != VK_SUCCESS)
+	std::vector<char> uniformData(stride * m_settings.m_materialCount);
+	for (uint32_t i = 0; i < m_settings.m_materialCount; ++i)
 	{
-		return false;
+		float color[4] =
+		{
+			1, static_cast<float>(i) / m_settings.m_materialCount, 0, 1,
+		};
+		memcpy(&uniformData[i * stride], color, sizeof(color));
 	}
-	vkGetBufferMemoryRequirements(m_device, m_uniformBuffer.m_buffer, &memoryRequirements);
 
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
-	{
-		if (memoryRequirements.memoryTypeBits & 1 << i
-			&&
-			memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-		{
-			VkMemoryAllocateInfo allocateInfo =
-			{
-				VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-				nullptr,
-				m_uniformBuffer.m_size,
-				i
-			};
-			result = vkAllocateMemory(m_device, &allocateInfo, nullptr, &m_uniformBuffer.m_deviceMemory);
-			if (result == VK_SUCCESS)
-			{
-				break;
-			}
-		}
-	}
-	if (m_uniformBuffer.m_deviceMemory == VK_NULL_HANDLE)
+	m_uniformBuffer.m_mappedData = nullptr;
+	retireBuffer(m_uniformBuffer.m_buffer, m_uniformBuffer.m_deviceMemory);
+	m_uniformBuffer.m_size = static_cast<uint32_t>(uniformData.size());
+	m_uniformBuffer.m_stride = stride;
+	VkMemoryPropertyFlags preferredFlags = m_settings.m_directWrite ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0;
+	if (!CreateBuffer(m_device, m_physicalDevice, m_memoryTracker, m_uniformBuffer.m_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferredFlags, UniformMemory, m_uniformBuffer.m_buffer, m_uniformBuffer.m_deviceMemory, &m_uniformBuffer.m_memoryFlags))
 	{
 		return false;
 	}
-	result = vkBindBufferMemory(m_device, m_uniformBuffer.m_buffer, m_uniformBuffer.m_deviceMemory, 0);
-	if (result != VK_SUCCESS)
+	if (m_uniformBuffer.m_memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
 	{
-		return false;
+		if (!MapMemory(m_device, m_uniformBuffer.m_deviceMemory, m_uniformBuffer.m_mappedData))
+		{
+			return false;
+		}
+		memcpy(m_uniformBuffer.m_mappedData, uniformData.data(), m_uniformBuffer.m_size);
+		FlushMemory(m_device, m_uniformBuffer.m_deviceMemory, m_uniformBuffer.m_memoryFlags);
+		return true;
 	}
-
-
-	void* mappedPtr;
-	result = vkMapMemory(m_device, m_stagingBuffer.m_deviceMemory, 0, m_uniformBuffer.m_size, 0, &mappedPtr);
-	if (result != VK_SUCCESS)
+	if (!WriteMemory(m_device, m_stagingBuffer.m_deviceMemory, uniformData.data(), m_uniformBuffer.m_size))
 	{
 		return false;
 	}
-	memcpy(mappedPtr, uniformData, m_uniformBuffer.m_size);
-	VkMappedMemoryRange mappedMemoryRange =
-	{
-		VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
-		nullptr,
-		m_stagingBuffer.m_deviceMemory,
-		0,
-		m_uniformBuffer.m_size,
-	};
-	vkFlushMappedMemoryRanges(m_device, 1, &mappedMemoryRange);
-	vkUnmapMemory(m_device, m_stagingBuffer.m_deviceMemory);
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo =
 	{
@@ -1363,57 +1600,41 @@ bool Tutorial03::createUniformBuffer()
 		nullptr,
 	};
 
-	VkCommandBuffer commandBuffer = m_renderingResources[0].m_commandBuffer;
+	VkCommandBuffer commandBuffer = m_uploadCommandBuffer;
 
 	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-
-	VkBufferCopy bufferCopy =
-	{
-		0,
-		0,
-		m_uniformBuffer.m_size,
-	};
-	vkCmdCopyBuffer(commandBuffer, m_stagingBuffer.m_buffer, m_uniformBuffer.m_buffer, 1, &bufferCopy);
-
-	VkBufferMemoryBarrier bufferMemoryBarrier =
-	{
-		VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-		nullptr,
-		VK_ACCESS_MEMORY_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_QUEUE_FAMILY_IGNORED,
-		VK_QUEUE_FAMILY_IGNORED,
-		m_uniformBuffer.m_buffer,
-		0,
-		VK_WHOLE_SIZE,
-	};
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
-	vkEndCommandBuffer(commandBuffer);
-	VkSubmitInfo submitInfo =
-	{
-		VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		nullptr,
-		0,
-		nullptr,
-		0,
-		1,
-		&commandBuffer,
-		0,
-		nullptr,
-	};
-	result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	m_gpuProfiler.beginFrame(commandBuffer, m_uploadProfilerSlot);
+	uint32_t uploadScope = m_gpuProfiler.beginScope(commandBuffer, "upload uniforms");
+
+	m_uploadGraph.reset();
+	uint32_t stagingResource = m_uploadGraph.importBuffer("staging", m_stagingBuffer.m_buffer, 0, m_uniformBuffer.m_size, UsageNone, UsageNone);
+	uint32_t uniformResource = m_uploadGraph.importBuffer("uniforms", m_uniformBuffer.m_buffer, 0, VK_WHOLE_SIZE, UsageNone, UsageUniformBuffer);
+	uint32_t copyPass = m_uploadGraph.addPass("copy uniforms", [&](VkCommandBuffer commandBuffer) {
+		VkBufferCopy bufferCopy =
+		{
+			0,
+			0,
+			m_uniformBuffer.m_size,
+		};
+		vkCmdCopyBuffer(commandBuffer, m_stagingBuffer.m_buffer, m_uniformBuffer.m_buffer, 1, &bufferCopy);
+	});
+	m_uploadGraph.read(copyPass, stagingResource, UsageTransferSrc);
+	m_uploadGraph.write(copyPass, uniformResource, UsageTransferDst);
+	if (!m_uploadGraph.compile())
 	{
 		return false;
 	}
-	vkDeviceWaitIdle(m_device);
-	return true;
-
+	m_uploadGraph.execute(commandBuffer);
+	m_gpuProfiler.endScope(commandBuffer, uploadScope);
+	vkEndCommandBuffer(commandBuffer);
+	return submitAndWait(commandBuffer);
 }
 
 bool Tutorial03::createDescriptorSet()
 {
+	TRACE_FUNCTION();
 	VkResult result;
+	retireDescriptorSet(m_descriptorSet);
 	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[] =
 	{
 		{
@@ -1450,11 +1671,11 @@ bool Tutorial03::createDescriptorSet()
 	{
 		{
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			1,
+			m_settings.m_materialCount,
 		},
 		{
 			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			1,
+			m_settings.m_materialCount,
 		},
 	};
 
@@ -1463,7 +1684,7 @@ bool Tutorial03::createDescriptorSet()
 		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 		nullptr,
 		0,
-		1,
+		m_settings.m_materialCount,
 		sizeof(descriptorPoolSizes)/ sizeof(descriptorPoolSizes[0]),
 		descriptorPoolSizes,
 	};
@@ -1474,73 +1695,81 @@ bool Tutorial03::createDescriptorSet()
 		return false;
 	}
 
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(m_settings.m_materialCount, m_descriptorSet.m_descriptorSetLayout);
 	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo =
 	{
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		nullptr, 
 		m_descriptorSet.m_descriptorPool,
-		1,
-		&m_descriptorSet.m_descriptorSetLayout,
+		m_settings.m_materialCount,
+		descriptorSetLayouts.data(),
 	};
 
-	result = vkAllocateDescriptorSets(m_device, &descriptorSetAllocateInfo, &m_descriptorSet.m_descriptorSet);
+	m_descriptorSet.m_descriptorSets.resize(m_settings.m_materialCount);
+	result = vkAllocateDescriptorSets(m_device, &descriptorSetAllocateInfo, m_descriptorSet.m_descriptorSets.data());
 	if (result != VK_SUCCESS)
 	{
 		return false;
 	}
-	
-	VkDescriptorImageInfo descriptorImageInfo = 
-	{
-		m_texture.m_sampler,
-		m_texture.m_imageView,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	};
 
-	VkDescriptorBufferInfo descriptorBufferInfo =
+	for (uint32_t i = 0; i < m_settings.m_materialCount; ++i)
 	{
-		m_uniformBuffer.m_buffer,
-		0,
-		m_uniformBuffer.m_size,
-	};
+		const Texture& texture = m_textures[i % m_textures.size()];
+		VkDescriptorImageInfo descriptorImageInfo =
+		{
+			texture.m_sampler,
+			texture.m_imageView,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		};
 
-	VkWriteDescriptorSet writeDescriptorSets[] =
-	{
+		VkDescriptorBufferInfo descriptorBufferInfo =
 		{
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			nullptr,
-			m_descriptorSet.m_descriptorSet,
-			0,
-			0,
-			1,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			&descriptorImageInfo,
-			nullptr,
-			nullptr,
-		},
+			m_uniformBuffer.m_buffer,
+			i * m_uniformBuffer.m_stride,
+			sizeof(float) * 4,
+		};
+
+		VkWriteDescriptorSet writeDescriptorSets[] =
 		{
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			nullptr,
-			m_descriptorSet.m_descriptorSet,
-			1,
-			0,
-			1,
-			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			nullptr,
-			&descriptorBufferInfo,
-			nullptr,
-		},
-	};
-	
-	vkUpdateDescriptorSets(m_device, sizeof(writeDescriptorSets) / sizeof(writeDescriptorSets[0]), writeDescriptorSets, 0, nullptr);
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				nullptr,
+				m_descriptorSet.m_descriptorSets[i],
+				0,
+				0,
+				1,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				&descriptorImageInfo,
+				nullptr,
+				nullptr,
+			},
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				nullptr,
+				m_descriptorSet.m_descriptorSets[i],
+				1,
+				0,
+				1,
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				nullptr,
+				&descriptorBufferInfo,
+				nullptr,
+			},
+		};
+
+		vkUpdateDescriptorSets(m_device, sizeof(writeDescriptorSets) / sizeof(writeDescriptorSets[0]), writeDescriptorSets, 0, nullptr);
+	}
+	return true;
 }
 
 bool Tutorial03::createPipeline()
 {
+	TRACE_FUNCTION();
 	std::string path(QCoreApplication::applicationDirPath().toStdString());
 
 	VkResult result;
-	VkShaderModule vertexShaderModule = createShaderModule((path + "/shader03.vert.spv").c_str());
-	VkShaderModule fragmentShaderModule = createShaderModule((path + "/shader03.frag.spv").c_str());
+	VkShaderModule vertexShaderModule = CreateShaderModule(m_device, (path + "/shader03.vert.spv").c_str());
+	VkShaderModule fragmentShaderModule = CreateShaderModule(m_device, (path + "/shader03.frag.spv").c_str());
 	if (VK_NULL_HANDLE == vertexShaderModule || VK_NULL_HANDLE == fragmentShaderModule)
 	{
 		return false;
@@ -1568,40 +1797,18 @@ bool Tutorial03::createPipeline()
 		},
 	};
 
-	VkVertexInputBindingDescription vertexInputBindingDescriptions[] =
-	{
-		{
-			0,
-			sizeof(VertexData),
-			VK_VERTEX_INPUT_RATE_VERTEX,
-		},
-	};
-
-	VkVertexInputAttributeDescription vertexInputAttributeDescriptions[]=
-	{
-		{
-			0,
-			0,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			0,
-		},
-		{
-			1,
-			0,
-			VK_FORMAT_R32G32B32A32_SFLOAT,
-			sizeof(float) * 4,
-		},
-	};
+	std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions = m_vertexLayout.bindingDescriptions();
+	std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions = m_vertexLayout.attributeDescriptions();
 
 	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo =
 	{
 		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 		nullptr,
 		0,
-		sizeof(vertexInputBindingDescriptions)/sizeof(vertexInputBindingDescriptions[0]),
-		vertexInputBindingDescriptions,
-		sizeof(vertexInputAttributeDescriptions)/sizeof(vertexInputAttributeDescriptions[0]),
-		vertexInputAttributeDescriptions,
+		static_cast<uint32_t>(vertexInputBindingDescriptions.size()),
+		vertexInputBindingDescriptions.data(),
+		static_cast<uint32_t>(vertexInputAttributeDescriptions.size()),
+		vertexInputAttributeDescriptions.data(),
 	};
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo =
@@ -1647,7 +1854,7 @@ bool Tutorial03::createPipeline()
 		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
 		nullptr,
 		0,
-		VK_SAMPLE_COUNT_1_BIT,
+		m_sampleCount,
 		VK_FALSE,
 		1,
 		nullptr,
@@ -1655,6 +1862,27 @@ bool Tutorial03::createPipeline()
 		VK_FALSE,
 	};
 
+	// a fragment shader without discard or depth writes lets the test run before shading. after a
+	// depth prepass the depth is final and only the nearest fragments pass, both vertex shaders
+	// declare gl_Position invariant so they produce the same depth
+	VkBool32 depthTest = m_depthFormat != VK_FORMAT_UNDEFINED ? VK_TRUE : VK_FALSE;
+	bool depthPrepass = depthTest == VK_TRUE && m_settings.m_depthPrepass;
+	VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		nullptr,
+		0,
+		depthTest,
+		depthPrepass ? VK_FALSE : depthTest,
+		depthPrepass ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS,
+		VK_FALSE,
+		VK_FALSE,
+		{},
+		{},
+		0.0f,
+		1.0f,
+	};
+
 	VkPipelineColorBlendAttachmentState colorBlendAttachmentState =
 	{
 		VK_FALSE,
@@ -1725,7 +1953,7 @@ bool Tutorial03::createPipeline()
 		&viewportStateCreateInfo,
 		&rasterizationStateCreateInfo,
 		&multisampleStateCreateInfo,
-		nullptr,
+		&depthStencilStateCreateInfo,
 		&colorBlendStateCreateInfo,
 		&dynamicStateCreateInfo,
 		m_pipelineLayout,
@@ -1736,6 +1964,93 @@ bool Tutorial03::createPipeline()
 	};
 
 	result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &m_pipeline);
+
+	// the overlay draws indexed triangle and line lists over everything, without depth
+	VkPipelineInputAssemblyStateCreateInfo triangleListStateCreateInfo = inputAssemblyStateCreateInfo;
+	triangleListStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPipelineInputAssemblyStateCreateInfo lineListStateCreateInfo = inputAssemblyStateCreateInfo;
+	lineListStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+	VkPipelineDepthStencilStateCreateInfo overlayDepthStencilStateCreateInfo = depthStencilStateCreateInfo;
+	overlayDepthStencilStateCreateInfo.depthTestEnable = VK_FALSE;
+	overlayDepthStencilStateCreateInfo.depthWriteEnable = VK_FALSE;
+	VkGraphicsPipelineCreateInfo overlayPipelineCreateInfos[] =
+	{
+		graphicsPipelineCreateInfo,
+		graphicsPipelineCreateInfo,
+	};
+	overlayPipelineCreateInfos[overlay_triangles].pInputAssemblyState = &triangleListStateCreateInfo;
+	overlayPipelineCreateInfos[overlay_lines].pInputAssemblyState = &lineListStateCreateInfo;
+	// immediate mode vertices stay full floats whatever the quads use
+	VertexLayout overlayLayout = FullVertexLayout();
+	std::vector<VkVertexInputBindingDescription> overlayBindingDescriptions = overlayLayout.bindingDescriptions();
+	std::vector<VkVertexInputAttributeDescription> overlayAttributeDescriptions = overlayLayout.attributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo overlayVertexInputStateCreateInfo = vertexInputStateCreateInfo;
+	overlayVertexInputStateCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(overlayBindingDescriptions.size());
+	overlayVertexInputStateCreateInfo.pVertexBindingDescriptions = overlayBindingDescriptions.data();
+	overlayVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(overlayAttributeDescriptions.size());
+	overlayVertexInputStateCreateInfo.pVertexAttributeDescriptions = overlayAttributeDescriptions.data();
+	for (VkGraphicsPipelineCreateInfo& overlayPipelineCreateInfo : overlayPipelineCreateInfos)
+	{
+		overlayPipelineCreateInfo.pVertexInputState = &overlayVertexInputStateCreateInfo;
+		overlayPipelineCreateInfo.pDepthStencilState = &overlayDepthStencilStateCreateInfo;
+	}
+	// meshes are indexed triangle lists depth tested like the quads
+	VkGraphicsPipelineCreateInfo meshPipelineCreateInfo = graphicsPipelineCreateInfo;
+	meshPipelineCreateInfo.pInputAssemblyState = &triangleListStateCreateInfo;
+	if (result == VK_SUCCESS && (!m_settings.m_meshFile.empty() || m_settings.m_meshGridSize > 0))
+	{
+		result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &meshPipelineCreateInfo, nullptr, &m_meshPipeline);
+	}
+	if (result == VK_SUCCESS && m_settings.m_debugOverlay)
+	{
+		m_overlayPipelines.assign(2, VK_NULL_HANDLE);
+		result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 2, overlayPipelineCreateInfos, nullptr, m_overlayPipelines.data());
+	}
+
+	// the prepass only fetches binding 0 and writes depth, without a fragment shader or color writes
+	VkShaderModule depthShaderModule = depthPrepass ? CreateShaderModule(m_device, (path + "/shader03_depth.vert.spv").c_str()) : VK_NULL_HANDLE;
+	VkPipelineShaderStageCreateInfo prepassShaderStageCreateInfo = shaderStageCreateInfos[0];
+	prepassShaderStageCreateInfo.module = depthShaderModule;
+	std::vector<VkVertexInputAttributeDescription> prepassAttributeDescriptions;
+	for (const VkVertexInputAttributeDescription& attributeDescription : vertexInputAttributeDescriptions)
+	{
+		if (attributeDescription.binding == 0)
+		{
+			prepassAttributeDescriptions.push_back(attributeDescription);
+		}
+	}
+	VkPipelineVertexInputStateCreateInfo prepassVertexInputStateCreateInfo = vertexInputStateCreateInfo;
+	prepassVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+	prepassVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(prepassAttributeDescriptions.size());
+	prepassVertexInputStateCreateInfo.pVertexAttributeDescriptions = prepassAttributeDescriptions.data();
+	VkPipelineDepthStencilStateCreateInfo prepassDepthStencilStateCreateInfo = depthStencilStateCreateInfo;
+	prepassDepthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;
+	prepassDepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+	VkPipelineColorBlendAttachmentState prepassColorBlendAttachmentState = colorBlendAttachmentState;
+	prepassColorBlendAttachmentState.colorWriteMask = 0;
+	VkPipelineColorBlendStateCreateInfo prepassColorBlendStateCreateInfo = colorBlendStateCreateInfo;
+	prepassColorBlendStateCreateInfo.pAttachments = &prepassColorBlendAttachmentState;
+	VkGraphicsPipelineCreateInfo prepassPipelineCreateInfos[] =
+	{
+		graphicsPipelineCreateInfo,
+		meshPipelineCreateInfo,
+	};
+	for (VkGraphicsPipelineCreateInfo& prepassPipelineCreateInfo : prepassPipelineCreateInfos)
+	{
+		prepassPipelineCreateInfo.stageCount = 1;
+		prepassPipelineCreateInfo.pStages = &prepassShaderStageCreateInfo;
+		prepassPipelineCreateInfo.pVertexInputState = &prepassVertexInputStateCreateInfo;
+		prepassPipelineCreateInfo.pDepthStencilState = &prepassDepthStencilStateCreateInfo;
+		prepassPipelineCreateInfo.pColorBlendState = &prepassColorBlendStateCreateInfo;
+	}
+	if (result == VK_SUCCESS && depthPrepass)
+	{
+		m_prepassPipelines.assign(2, VK_NULL_HANDLE);
+		result = depthShaderModule != VK_NULL_HANDLE ? vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 2, prepassPipelineCreateInfos, nullptr, m_prepassPipelines.data()) : VK_ERROR_INITIALIZATION_FAILED;
+	}
+	vkDestroyShaderModule(m_device, vertexShaderModule, nullptr);
+	vkDestroyShaderModule(m_device, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(m_device, depthShaderModule, nullptr);
 	if (result != VK_SUCCESS)
 	{
 		return false;
@@ -1745,56 +2060,64 @@ bool Tutorial03::createPipeline()
 
 bool Tutorial03::draw()
 {
+	TRACE_FUNCTION();
 	VkResult result;
-	static uint32_t s_resourceIndex = 0;
-	RenderingResource& renderingResource = m_renderingResources[s_resourceIndex];
+	uint32_t resourceIndex = m_resourceIndex;
+	RenderingResource& renderingResource = m_renderingResources[resourceIndex];
 	uint32_t imageIndex;
-	s_resourceIndex = (s_resourceIndex + 1) % rendering_resource_count;
+	m_resourceIndex = (m_resourceIndex + 1) % static_cast<uint32_t>(m_renderingResources.size());
 
-	result = vkWaitForFences(m_device, 1, &renderingResource.m_fence, VK_FALSE, 1000000000ULL);
-	if (result != VK_SUCCESS)
+	FrameSample frameSample;
+	int64_t frameStart = Tracer::now();
+	bool hasPreviousFrame = m_lastFrameStart != 0;
+	frameSample.m_values[FrameTime] = (frameStart - m_lastFrameStart) / 1000;
+	m_lastFrameStart = frameStart;
+
+	{
+		TRACE_SCOPE("wait frame");
+		if (!waitForSerial(renderingResource.m_serial, 1000000000ULL))
+		{
+			return false;
+		}
+	}
+	frameSample.m_values[FenceWait] = (Tracer::now() - frameStart) / 1000;
+	updateCompletedSerial();
+	m_deletionQueue.flush(m_completedSerial);
+	m_memoryTracker.update();
+	m_readbackRing.collect(m_completedSerial, [this](const ReadbackFrame& frame) { writeCapture(frame); });
+
+	VkDeviceSize vertexOffset = 0;
+	if (m_settings.m_dynamicVertices && !streamVertices(resourceIndex, vertexOffset))
 	{
 		return false;
 	}
-	vkResetFences(m_device, 1, &renderingResource.m_fence);
 
-	result = vkAcquireNextImageKHR(m_device, m_swapChain, UINT64_MAX, renderingResource.m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	int64_t acquireStart = Tracer::now();
+	if (m_settings.m_headless)
+	{
+		imageIndex = resourceIndex;
+		result = VK_SUCCESS;
+	}
+	else
+	{
+		TRACE_SCOPE("vkAcquireNextImageKHR");
+		result = vkAcquireNextImageKHR(m_device, m_swapChain, UINT64_MAX, renderingResource.m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	}
+	frameSample.m_values[AcquireWait] = (Tracer::now() - acquireStart) / 1000;
 	switch (result)
 	{
 	case VK_SUCCESS:
 	case VK_SUBOPTIMAL_KHR:
 		break;
 	case VK_ERROR_OUT_OF_DATE_KHR:
-		return onSizeWindow();
+		m_swapChainDirty = true;
+		return true;
 	default:
 		return false;
 	}
 
 	SwapchainImage& swapchainImage = m_swapChainImages[imageIndex];
-
-	if (renderingResource.m_framebuffer != VK_NULL_HANDLE)
-	{
-		vkDestroyFramebuffer(m_device, renderingResource.m_framebuffer, nullptr);
-	}
-
-	VkFramebufferCreateInfo framebufferCreateInfo =
-	{
-		VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-		nullptr,
-		0,
-		m_renderPass,
-		1,
-		&swapchainImage.m_imageView,
-		m_swapChainExtent.width,
-		m_swapChainExtent.height,
-		1,
-	};
-
-	result = vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &renderingResource.m_framebuffer);
-	if (result != VK_SUCCESS)
-	{
-		return false;
-	}
+	TraceZone recordZone("record commands");
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo =
 	{
@@ -1804,134 +2127,337 @@ bool Tutorial03::draw()
 		nullptr,
 	};
 	vkBeginCommandBuffer(renderingResource.m_commandBuffer, &commandBufferBeginInfo);
-
-	VkImageSubresourceRange imageSubresourceRange =
-	{
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		0,
-		1,
-		0,
-		1,
-	};
-
-	if (m_graphicsQueue != m_presentQueue)
-	{
-		VkImageMemoryBarrier presentToDrawBarrier =
+	m_gpuProfiler.beginFrame(renderingResource.m_commandBuffer, resourceIndex);
+	uint32_t frameScope = m_gpuProfiler.beginScope(renderingResource.m_commandBuffer, "frame");
+	buildDrawList(vertexOffset);
+	if (m_settings.m_debugOverlay)
+	{
+		buildOverlay(resourceIndex, frameSample.m_values[FrameTime] / 1000.0f);
+	}
+
+	// swapchain contents are discarded every frame so only the release to the present queue needs an ownership transfer
+	m_renderGraph.reset();
+	uint32_t backBuffer = m_renderGraph.importImage("back buffer", swapchainImage.m_image, m_swapChainFormat, UsageNone, m_settings.m_headless ? UsageTransferSrc : UsagePresent, m_settings.m_headless ? VK_QUEUE_FAMILY_IGNORED : m_presentQueueFamilyIndex);
+	// with readback on, a window renders offscreen and copies to the back buffer, headless targets are offscreen already
+	uint32_t colorTarget = backBuffer;
+	if (m_settings.m_readback && !m_settings.m_headless)
+	{
+		RenderGraphImageDesc colorDesc;
+		colorDesc.m_format = m_swapChainFormat;
+		colorDesc.m_extent = m_swapChainExtent;
+		colorDesc.m_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		colorTarget = m_renderGraph.createImage("scene color", colorDesc);
+	}
+	// transient attachments prefer lazily allocated memory, on tilers the samples then never leave the tile
+	uint32_t multisampleColor = UINT32_MAX;
+	if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT)
+	{
+		RenderGraphImageDesc multisampleDesc;
+		multisampleDesc.m_format = m_swapChainFormat;
+		multisampleDesc.m_extent = m_swapChainExtent;
+		multisampleDesc.m_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		multisampleDesc.m_samples = m_sampleCount;
+		multisampleColor = m_renderGraph.createImage("msaa color", multisampleDesc);
+	}
+	uint32_t depth = UINT32_MAX;
+	if (m_depthFormat != VK_FORMAT_UNDEFINED)
+	{
+		RenderGraphImageDesc depthDesc;
+		depthDesc.m_format = m_depthFormat;
+		depthDesc.m_extent = m_swapChainExtent;
+		depthDesc.m_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		depthDesc.m_samples = m_sampleCount;
+		depth = m_renderGraph.createImage("depth", depthDesc);
+	}
+	uint32_t vertices = m_renderGraph.importBuffer("vertices", m_vertexBuffer.m_buffer, vertexOffset, m_vertexBuffer.m_size, m_settings.m_dynamicVertices ? UsageNone : UsageVertexBuffer, UsageNone);
+	if (m_settings.m_dynamicVertices && m_vertexStagingBuffer.m_mappedData != nullptr)
+	{
+		uint32_t vertexStaging = m_renderGraph.importBuffer("vertex staging", m_vertexStagingBuffer.m_buffer, vertexOffset, m_vertexBuffer.m_size, UsageNone, UsageNone);
+		uint32_t streamPass = m_renderGraph.addPass("stream vertices", [&](VkCommandBuffer commandBuffer) {
+			VkBufferCopy bufferCopy =
+			{
+				vertexOffset,
+				vertexOffset,
+				m_vertexBuffer.m_size,
+			};
+			vkCmdCopyBuffer(commandBuffer, m_vertexStagingBuffer.m_buffer, m_vertexBuffer.m_buffer, 1, &bufferCopy);
+		});
+		m_renderGraph.read(streamPass, vertexStaging, UsageTransferSrc);
+		m_renderGraph.write(streamPass, vertices, UsageTransferDst);
+	}
+	uint32_t mainPass = m_renderGraph.addPass("render pass", [&](VkCommandBuffer commandBuffer) {
+		// the framebuffer is only created after compile, its attachments follow the render pass order
+		uint32_t depthAttachment = multisampleColor != UINT32_MAX ? 2 : 1;
+		uint32_t attachmentCount = depth != UINT32_MAX ? depthAttachment + 1 : depthAttachment;
+		VkClearValue clearValues[3] =
+		{
+			{0,0,0,0},
+			{0,0,0,0},
+			{0,0,0,0},
+		};
+		clearValues[depthAttachment].depthStencil = { 1.0f, 0 };
+		VkRenderPassBeginInfo renderPassBeginInfo =
 		{
-			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
 			nullptr,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			m_presentQueueFamilyIndex,
-			m_graphicsQueueFamilyIndex,
-			swapchainImage.m_image,
-			imageSubresourceRange
+			m_renderPass,
+			renderingResource.m_framebuffer,
+			{
+				{
+					0,
+					0,
+				},
+				{
+					m_swapChainExtent.width,
+					m_swapChainExtent.height,
+				},
+			},
+			attachmentCount,
+			clearValues,
 		};
-		vkCmdPipelineBarrier(renderingResource.m_commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &presentToDrawBarrier);
-	}
 
+		// the render pass is timed on its own, apart from streaming, copies and readback in the same frame
+		uint32_t mainPassScope = m_gpuProfiler.beginScope(commandBuffer, "main pass");
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	VkClearValue clearValue =
-	{
-		{0,0,0,0},
-	};
-	VkRenderPassBeginInfo renderPassBeginInfo =
-	{
-		VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		nullptr,
-		m_renderPass,
-		renderingResource.m_framebuffer,
+		VkViewport viewport =
+		{
+			0,
+			0,
+			m_swapChainExtent.width,
+			m_swapChainExtent.height,
+			0,
+			1,
+		};
+	
+		VkRect2D scissor =
 		{
 			{
 				0,
-				0,
+				0
 			},
 			{
 				m_swapChainExtent.width,
 				m_swapChainExtent.height,
 			},
-		},
-		1,
-		&clearValue,
-	};
-
-	vkCmdBeginRenderPass(renderingResource.m_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(renderingResource.m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+		};
 
-	VkViewport viewport =
-	{
-		0,
-		0,
-		m_swapChainExtent.width,
-		m_swapChainExtent.height,
-		0,
-		1,
-	};
-	
-	VkRect2D scissor =
-	{
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		static const char* const draw_group_names[] =
 		{
-			0,
-			0
-		},
+			"draw group 0",
+			"draw group 1",
+			"draw group 2",
+			"draw group 3",
+			"draw group 4",
+			"draw group 5",
+			"draw group 6",
+			"draw group 7+",
+		};
+		const uint32_t draw_group_count = sizeof(draw_group_names) / sizeof(draw_group_names[0]);
+		uint32_t drawGroupSize = m_settings.m_drawGroupSize > 0 ? m_settings.m_drawGroupSize : m_settings.m_quadCount;
+		uint32_t drawGroupQuery = UINT32_MAX;
+		if (!m_prepassPipelines.empty())
 		{
-			m_swapChainExtent.width,
-			m_swapChainExtent.height,
-		},
-	};
-
-	vkCmdSetViewport(renderingResource.m_commandBuffer, 0, 1, &viewport);
-	vkCmdSetScissor(renderingResource.m_commandBuffer, 0, 1, &scissor);
-	VkDeviceSize offset = 0;
-	vkCmdBindVertexBuffers(renderingResource.m_commandBuffer, 0, 1, &m_vertexBuffer.m_buffer, &offset);
-	vkCmdBindDescriptorSets(renderingResource.m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet.m_descriptorSet, 0, nullptr);
-	vkCmdDraw(renderingResource.m_commandBuffer, 4, 1, 0, 0);
-	vkCmdEndRenderPass(renderingResource.m_commandBuffer);
-
-	if (m_graphicsQueue != m_presentQueue)
-	{
-		VkImageMemoryBarrier drawToPresentBarrier =
+			m_drawList.record(commandBuffer, m_prepassBindings);
+			m_prepassCounters = m_drawList.counters();
+		}
+		m_drawList.record(commandBuffer, m_drawBindings, [&](VkCommandBuffer, uint32_t i) {
+			if (i % drawGroupSize == 0)
+			{
+				m_gpuProfiler.endPipelineStatistics(commandBuffer, drawGroupQuery);
+				drawGroupQuery = m_gpuProfiler.beginPipelineStatistics(commandBuffer, draw_group_names[min(i / drawGroupSize, draw_group_count - 1)]);
+			}
+		});
+		m_gpuProfiler.endPipelineStatistics(commandBuffer, drawGroupQuery);
+		if (m_settings.m_debugOverlay)
 		{
-			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-			nullptr,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			m_graphicsQueueFamilyIndex,
-			m_presentQueueFamilyIndex,
-			swapchainImage.m_image,
-			imageSubresourceRange
-		};
-		vkCmdPipelineBarrier(renderingResource.m_commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &drawToPresentBarrier);
+			m_overlayDrawList.record(commandBuffer, m_overlayBindings);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+		m_gpuProfiler.endScope(commandBuffer, mainPassScope);
+	});
+	m_renderGraph.read(mainPass, vertices, UsageVertexBuffer);
+	m_renderGraph.write(mainPass, colorTarget, UsageColorAttachment);
+	if (multisampleColor != UINT32_MAX)
+	{
+		m_renderGraph.write(mainPass, multisampleColor, UsageColorAttachment);
 	}
-
-	result = vkEndCommandBuffer(renderingResource.m_commandBuffer);
-	if (result != VK_SUCCESS)
+	if (depth != UINT32_MAX)
+	{
+		m_renderGraph.write(mainPass, depth, UsageDepthAttachment);
+	}
+	if (colorTarget != backBuffer)
+	{
+		uint32_t presentCopyPass = m_renderGraph.addPass("copy to back buffer", [&](VkCommandBuffer commandBuffer) {
+			VkImageCopy imageCopy =
+			{
+				{
+					VK_IMAGE_ASPECT_COLOR_BIT,
+					0,
+					0,
+					1,
+				},
+				{
+					0,
+					0,
+					0,
+				},
+				{
+					VK_IMAGE_ASPECT_COLOR_BIT,
+					0,
+					0,
+					1,
+				},
+				{
+					0,
+					0,
+					0,
+				},
+				{
+					m_swapChainExtent.width,
+					m_swapChainExtent.height,
+					1,
+				},
+			};
+			vkCmdCopyImage(commandBuffer, m_renderGraph.image(colorTarget), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImage.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
+		});
+		m_renderGraph.read(presentCopyPass, colorTarget, UsageTransferSrc);
+		m_renderGraph.write(presentCopyPass, backBuffer, UsageTransferDst);
+	}
+	// the copy lands in a ring slot that is only read on the host once this frame's serial completes
+	uint32_t readbackSlot = UINT32_MAX;
+	if (m_readbackRing.matches(m_swapChainFormat, m_swapChainExtent) && (0 == m_settings.m_captureFrameCount || m_frameNumber < m_settings.m_captureFrameCount))
+	{
+		readbackSlot = m_readbackRing.acquire(m_frameNumber, m_submittedSerial + 1);
+	}
+	if (readbackSlot != UINT32_MAX)
+	{
+		uint32_t readbackBuffer = m_renderGraph.importBuffer("readback", m_readbackRing.buffer(readbackSlot), 0, m_readbackRing.frameSize(), UsageNone, UsageHostRead);
+		uint32_t readbackPass = m_renderGraph.addPass("readback", [&](VkCommandBuffer commandBuffer) {
+			m_readbackRing.copy(commandBuffer, m_renderGraph.image(colorTarget), readbackSlot);
+		});
+		m_renderGraph.read(readbackPass, colorTarget, UsageTransferSrc);
+		m_renderGraph.write(readbackPass, readbackBuffer, UsageTransferDst);
+	}
+	if (!m_renderGraph.compile())
 	{
+		abandonFrame(renderingResource, readbackSlot);
 		return false;
 	}
 
-	VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	VkSubmitInfo submitInfo =
+	VkImageView colorView = colorTarget == backBuffer ? swapchainImage.m_imageView : m_renderGraph.imageView(colorTarget);
+	// same order as the render pass: color or its samples, the resolve target, depth
+	VkImageView attachments[3];
+	uint32_t attachmentCount = 0;
+	if (multisampleColor != UINT32_MAX)
 	{
-		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		attachments[attachmentCount++] = m_renderGraph.imageView(multisampleColor);
+		m_multisampleLazy = (m_renderGraph.memoryFlags(multisampleColor) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+	}
+	attachments[attachmentCount++] = colorView;
+	if (depth != UINT32_MAX)
+	{
+		attachments[attachmentCount++] = m_renderGraph.imageView(depth);
+	}
+	if (renderingResource.m_framebuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyFramebuffer(m_device, renderingResource.m_framebuffer, nullptr);
+	}
+
+	VkFramebufferCreateInfo framebufferCreateInfo =
+	{
+		VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
 		nullptr,
+		0,
+		m_renderPass,
+		attachmentCount,
+		attachments,
+		m_swapChainExtent.width,
+		m_swapChainExtent.height,
 		1,
+	};
+
+	result = vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &renderingResource.m_framebuffer);
+	if (result != VK_SUCCESS)
+	{
+		abandonFrame(renderingResource, readbackSlot);
+		return false;
+	}
+
+	m_renderGraph.execute(renderingResource.m_commandBuffer);
+
+	m_gpuProfiler.endScope(renderingResource.m_commandBuffer, frameScope);
+	result = vkEndCommandBuffer(renderingResource.m_commandBuffer);
+	if (result != VK_SUCCESS)
+	{
+		abandonFrame(renderingResource, readbackSlot);
+		return false;
+	}
+	recordZone.end();
+
+	renderingResource.m_serial = ++m_submittedSerial;
+	++m_frameNumber;
+
+	// an offscreen scene color reaches the back buffer through a copy, which then is its first use
+	VkPipelineStageFlags waitDstStageMask = colorTarget != backBuffer ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	uint32_t waitSemaphoreCount = m_settings.m_headless ? 0u : 1u;
+	uint32_t firstSignalSemaphore = m_settings.m_headless ? 1u : 0u;
+	uint32_t signalSemaphoreCount = (m_timelineSemaphoreSupported ? 2u : 1u) - firstSignalSemaphore;
+	VkSemaphore signalSemaphores[] =
+	{
+		renderingResource.m_renderingFinishedSemaphore,
+		m_timelineSemaphore,
+	};
+	uint64_t waitValue = 0;
+	uint64_t signalValues[] =
+	{
+		0,
+		renderingResource.m_serial,
+	};
+	VkTimelineSemaphoreSubmitInfoKHR timelineSemaphoreSubmitInfo =
+	{
+		VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+		nullptr,
+		waitSemaphoreCount,
+		&waitValue,
+		signalSemaphoreCount,
+		signalValues + firstSignalSemaphore,
+	};
+	VkSubmitInfo submitInfo =
+	{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		m_timelineSemaphoreSupported ? &timelineSemaphoreSubmitInfo : nullptr,
+		waitSemaphoreCount,
 		&renderingResource.m_imageAvailableSemaphore,
 		&waitDstStageMask,
 		1,
 		&renderingResource.m_commandBuffer,
-		1,
-		&renderingResource.m_renderingFinishedSemaphore,
+		signalSemaphoreCount,
+		signalSemaphores + firstSignalSemaphore,
 	};
-	result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, renderingResource.m_fence);
+	// the fence is only reset once nothing can keep the frame from being submitted
+	if (!m_timelineSemaphoreSupported)
+	{
+		vkResetFences(m_device, 1, &renderingResource.m_fence);
+	}
+	{
+		TRACE_SCOPE("vkQueueSubmit");
+		result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_timelineSemaphoreSupported ? VK_NULL_HANDLE : renderingResource.m_fence);
+	}
 	if (result != VK_SUCCESS)
 	{
 		return false;
 	}
+	if (m_settings.m_headless)
+	{
+		if (hasPreviousFrame)
+		{
+			m_frameStatistics.record(frameSample, frameStart / 1000);
+		}
+		return true;
+	}
 
 	VkPresentInfoKHR presentInfo =
 	{
@@ -1945,36 +2471,476 @@ bool Tutorial03::draw()
 		nullptr,
 	};
 
-	result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	int64_t presentStart = Tracer::now();
+	{
+		TRACE_SCOPE("vkQueuePresentKHR");
+		result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	}
+	frameSample.m_values[PresentTime] = (Tracer::now() - presentStart) / 1000;
 	switch (result) 
 	{
 	case VK_SUCCESS:
 		break;
 	case VK_ERROR_OUT_OF_DATE_KHR:
 	case VK_SUBOPTIMAL_KHR:
-		return onSizeWindow();
+		m_swapChainDirty = true;
+		break;
 	default:
 		return false;
 	}
+	if (hasPreviousFrame)
+	{
+		m_frameStatistics.record(frameSample, frameStart / 1000);
+	}
+	if (m_pendingInputTimestamp != 0)
+	{
+		recordInputLatency(Tracer::now() - m_pendingInputTimestamp);
+		m_pendingInputTimestamp = 0;
+	}
 	return true;
 }
 
+// a frame given up on after the acquire still submits an empty batch, it consumes the image available
+// semaphore and completes a serial of its own so later waits on this rendering resource return.
+// its readback slot goes back to the ring, nothing was copied into it
+void Tutorial03::abandonFrame(RenderingResource& renderingResource, uint32_t readbackSlot)
+{
+	if (readbackSlot != UINT32_MAX)
+	{
+		m_readbackRing.release(readbackSlot);
+	}
+	vkResetCommandBuffer(renderingResource.m_commandBuffer, 0);
+	renderingResource.m_serial = ++m_submittedSerial;
+
+	VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	uint32_t waitSemaphoreCount = m_settings.m_headless ? 0u : 1u;
+	uint64_t waitValue = 0;
+	VkTimelineSemaphoreSubmitInfoKHR timelineSemaphoreSubmitInfo =
+	{
+		VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+		nullptr,
+		waitSemaphoreCount,
+		&waitValue,
+		1,
+		&renderingResource.m_serial,
+	};
+	VkSubmitInfo submitInfo =
+	{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		m_timelineSemaphoreSupported ? &timelineSemaphoreSubmitInfo : nullptr,
+		waitSemaphoreCount,
+		&renderingResource.m_imageAvailableSemaphore,
+		&waitDstStageMask,
+		0,
+		nullptr,
+		m_timelineSemaphoreSupported ? 1u : 0u,
+		&m_timelineSemaphore,
+	};
+	if (!m_timelineSemaphoreSupported)
+	{
+		vkResetFences(m_device, 1, &renderingResource.m_fence);
+	}
+	vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_timelineSemaphoreSupported ? VK_NULL_HANDLE : renderingResource.m_fence);
+}
+
+bool Tutorial03::reloadTexture()
+{
+	if (!createTexture())
+	{
+		return false;
+	}
+	return createDescriptorSet();
+}
 
 bool Tutorial03::onSizeWindow()
 {
+	m_swapChainDirty = false;
+	VkFormat oldFormat = m_swapChainFormat;
 	if (!createSwapChain())
 	{
 		return false;
 	}
+	if (!createReadbackRing())
+	{
+		return false;
+	}
+	if (m_swapChainFormat == oldFormat)
+	{
+		return true;
+	}
+
+	retirePipeline();
+	if (!createRenderPass())
+	{
+		return false;
+	}
+	if (!createPipeline())
+	{
+		return false;
+	}
+	return true;
+}
+
+bool Tutorial03::waitForSerial(uint64_t serial, uint64_t timeout)
+{
+	VkResult result;
+	if (m_timelineSemaphoreSupported)
+	{
+		if (serial <= m_completedSerial)
+		{
+			return true;
+		}
+		VkSemaphoreWaitInfoKHR semaphoreWaitInfo =
+		{
+			VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+			nullptr,
+			0,
+			1,
+			&m_timelineSemaphore,
+			&serial,
+		};
+		result = m_vkWaitSemaphoresKHR(m_device, &semaphoreWaitInfo, timeout);
+		if (result != VK_SUCCESS)
+		{
+			return false;
+		}
+		m_completedSerial = serial;
+		return true;
+	}
+
+	std::vector<VkFence> fences;
+	for (RenderingResource& renderingResource : m_renderingResources)
+	{
+		if (renderingResource.m_serial <= serial)
+		{
+			fences.push_back(renderingResource.m_fence);
+		}
+	}
+	if (!fences.empty())
+	{
+		result = vkWaitForFences(m_device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, timeout);
+		if (result != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+	m_completedSerial = max(m_completedSerial, serial);
+	return true;
+}
+
+void Tutorial03::updateCompletedSerial()
+{
+	if (m_timelineSemaphoreSupported)
+	{
+		uint64_t value = 0;
+		if (m_vkGetSemaphoreCounterValueKHR(m_device, m_timelineSemaphore, &value) == VK_SUCCESS)
+		{
+			m_completedSerial = max(m_completedSerial, value);
+		}
+		return;
+	}
+	for (RenderingResource& renderingResource : m_renderingResources)
+	{
+		if (renderingResource.m_serial > m_completedSerial && vkGetFenceStatus(m_device, renderingResource.m_fence) == VK_SUCCESS)
+		{
+			m_completedSerial = renderingResource.m_serial;
+		}
+	}
+}
+
+bool Tutorial03::submitAndWait(VkCommandBuffer commandBuffer)
+{
+	VkResult result;
+	uint64_t serial = ++m_submittedSerial;
+	VkTimelineSemaphoreSubmitInfoKHR timelineSemaphoreSubmitInfo =
+	{
+		VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&serial,
+	};
+	VkSubmitInfo submitInfo =
+	{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		m_timelineSemaphoreSupported ? &timelineSemaphoreSubmitInfo : nullptr,
+		0,
+		nullptr,
+		nullptr,
+		1,
+		&commandBuffer,
+		m_timelineSemaphoreSupported ? 1u : 0u,
+		&m_timelineSemaphore,
+	};
+	if (m_timelineSemaphoreSupported)
+	{
+		result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		if (result != VK_SUCCESS)
+		{
+			return false;
+		}
+		if (!waitForSerial(serial))
+		{
+			return false;
+		}
+		m_gpuProfiler.resolve(m_uploadProfilerSlot);
+		return true;
+	}
+
+	vkResetFences(m_device, 1, &m_uploadFence);
+	result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_uploadFence);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	result = vkWaitForFences(m_device, 1, &m_uploadFence, VK_TRUE, UINT64_MAX);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+	m_completedSerial = serial;
+	m_gpuProfiler.resolve(m_uploadProfilerSlot);
 	return true;
 }
 
+void Tutorial03::startRenderThread()
+{
+	m_renderThreadRunning.store(true, std::memory_order_release);
+	m_renderThread = std::thread(&Tutorial03::renderLoop, this);
+}
+
+void Tutorial03::stopRenderThread()
+{
+	m_renderThreadRunning.store(false, std::memory_order_release);
+	if (m_renderThread.joinable())
+	{
+		m_renderThread.join();
+	}
+}
+
+void Tutorial03::renderLoop()
+{
+	Tracer::instance().setThreadName(Tracer::currentThreadId(), "render");
+	while (m_renderThreadRunning.load(std::memory_order_acquire))
+	{
+		if (!renderFrame())
+		{
+			// a lost device or a frame that could not be recorded does not recover by retrying
+			reportError("render frame failed, rendering stopped");
+			break;
+		}
+		if (m_swapChainDirty || m_swapChainImages.empty())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		reportStatistics();
+	}
+}
+
+void Tutorial03::evictMemory(uint32_t heapIndex, const MemoryHeapUsage& usage)
+{
+	qWarning() << "heap" << heapIndex << "usage" << usage.m_usage / 1024.0 / 1024.0 << "MB is close to budget" << usage.m_budget / 1024.0 / 1024.0 << "MB";
+	if (m_deletionQueue.size() == 0)
+	{
+		return;
+	}
+	// retired resources are the only thing that can be dropped without changing what is drawn
+	if (waitForSerial(m_submittedSerial))
+	{
+		m_deletionQueue.flush(m_completedSerial);
+	}
+}
+
+void Tutorial03::dumpTrace()
+{
+	QString fileName = QCoreApplication::applicationDirPath() + "/trace_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".json";
+	if (Tracer::instance().dump(fileName.toStdString()))
+	{
+		qDebug() << "trace written to" << fileName;
+	}
+	else
+	{
+		qWarning() << "could not write trace" << fileName;
+	}
+}
+
+void Tutorial03::reportStatistics()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_lastStatisticsReport < std::chrono::seconds(5))
+	{
+		return;
+	}
+	m_lastStatisticsReport = now;
+	for (uint32_t i = 0; i < FrameMetricCount; ++i)
+	{
+		MetricSummary summary = m_frameStatistics.summary(static_cast<FrameMetric>(i));
+		qDebug() << "cpu" << FrameStatistics::metricName(static_cast<FrameMetric>(i)) << "p50" << summary.m_p50 << "p95" << summary.m_p95 << "p99" << summary.m_p99 << "max" << summary.m_max << "us";
+	}
+	for (const GpuScopeStatistics& statistics : m_gpuProfiler.statistics())
+	{
+		qDebug() << "gpu" << statistics.m_name << "min" << statistics.m_min << "avg" << statistics.m_average << "p99" << statistics.m_p99 << "ms";
+	}
+	for (uint32_t i = 0; i < MemoryCategoryCount; ++i)
+	{
+		qDebug() << "memory" << MemoryTracker::categoryName(static_cast<MemoryCategory>(i)) << m_memoryTracker.allocated(static_cast<MemoryCategory>(i)) / 1024.0 / 1024.0 << "MB";
+	}
+	for (size_t i = 0; i < m_memoryTracker.heaps().size(); ++i)
+	{
+		const MemoryHeapUsage& heap = m_memoryTracker.heaps()[i];
+		qDebug() << "heap" << i << "allocations" << heap.m_allocationCount << "tracked" << heap.m_allocated / 1024.0 / 1024.0 << "MB"
+			<< "usage" << heap.m_usage / 1024.0 / 1024.0 << "MB" << "budget" << heap.m_budget / 1024.0 / 1024.0 << "MB";
+	}
+	for (const GpuPipelineStatistics& statistics : m_gpuProfiler.pipelineStatistics())
+	{
+		qDebug() << "gpu" << statistics.m_name << "primitives" << statistics.m_inputPrimitives
+			<< "vertex invocations" << statistics.m_vertexInvocations
+			<< "clipping invocations" << statistics.m_clippingInvocations
+			<< "clipping primitives" << statistics.m_clippingPrimitives
+			<< "fragment invocations" << statistics.m_fragmentInvocations;
+	}
+}
+
+void Tutorial03::processEvents()
+{
+	TRACE_FUNCTION();
+	if (m_resizePending.exchange(false, std::memory_order_acquire))
+	{
+		m_swapChainDirty = true;
+	}
+	RenderEvent event;
+	while (m_eventQueue.pop(event))
+	{
+		if (0 == m_pendingInputTimestamp)
+		{
+			m_pendingInputTimestamp = event.m_timestamp;
+		}
+		switch (event.m_type)
+		{
+		case RenderEvent::MouseMove:
+			m_inputState.m_cursorX = event.m_x;
+			m_inputState.m_cursorY = event.m_y;
+			break;
+		case RenderEvent::MousePress:
+			m_inputState.m_mouseButtons |= event.m_code;
+			break;
+		case RenderEvent::MouseRelease:
+			m_inputState.m_mouseButtons &= ~event.m_code;
+			break;
+		case RenderEvent::KeyPress:
+			m_inputState.m_pressedKeys.insert(event.m_code);
+			if (Qt::Key_F5 == event.m_code)
+			{
+				reloadTexture();
+			}
+			else if (Qt::Key_F12 == event.m_code)
+			{
+				dumpTrace();
+			}
+			break;
+		case RenderEvent::KeyRelease:
+			m_inputState.m_pressedKeys.erase(event.m_code);
+			break;
+		}
+	}
+}
+
+void Tutorial03::postEvent(RenderEvent event)
+{
+	event.m_timestamp = Tracer::now();
+	if (!m_eventQueue.push(event))
+	{
+		qWarning() << "render event queue full, event dropped";
+	}
+}
+
+void Tutorial03::recordInputLatency(int64_t latency)
+{
+	m_inputLatency.m_count++;
+	m_inputLatency.m_total += latency;
+	m_inputLatency.m_max = max(m_inputLatency.m_max, latency);
+	if (m_inputLatency.m_count == 100)
+	{
+		qDebug() << "frames in flight" << m_settings.m_framesInFlight
+			<< "swapchain images" << m_swapChainImages.size()
+			<< "input to present avg" << m_inputLatency.m_total / m_inputLatency.m_count / 1e6 << "ms"
+			<< "max" << m_inputLatency.m_max / 1e6 << "ms";
+		m_inputLatency = InputLatency();
+	}
+}
+
+void Tutorial03::reportError(const QString& message)
+{
+	if (m_settings.m_headless)
+	{
+		qWarning() << "error" << message;
+	}
+	else if (QThread::currentThread() == thread())
+	{
+		QMessageBox::critical(nullptr, "error", message);
+	}
+	else
+	{
+		QMetaObject::invokeMethod(this, [message]() { QMessageBox::critical(nullptr, "error", message); }, Qt::QueuedConnection);
+	}
+}
+
 void Tutorial03::resizeEvent(QResizeEvent* e)
 {
-	onSizeWindow();
+	m_resizePending.store(true, std::memory_order_release);
 }
 
-void Tutorial03::timerEvent(QTimerEvent *event)
+void Tutorial03::mouseMoveEvent(QMouseEvent* e)
 {
-	draw();
+	RenderEvent event;
+	event.m_type = RenderEvent::MouseMove;
+	event.m_x = e->x();
+	event.m_y = e->y();
+	postEvent(event);
+}
+
+void Tutorial03::mousePressEvent(QMouseEvent* e)
+{
+	RenderEvent event;
+	event.m_type = RenderEvent::MousePress;
+	event.m_x = e->x();
+	event.m_y = e->y();
+	event.m_code = e->button();
+	postEvent(event);
+}
+
+void Tutorial03::mouseReleaseEvent(QMouseEvent* e)
+{
+	RenderEvent event;
+	event.m_type = RenderEvent::MouseRelease;
+	event.m_x = e->x();
+	event.m_y = e->y();
+	event.m_code = e->button();
+	postEvent(event);
+}
+
+void Tutorial03::keyPressEvent(QKeyEvent* e)
+{
+	if (e->isAutoRepeat())
+	{
+		return;
+	}
+	RenderEvent event;
+	event.m_type = RenderEvent::KeyPress;
+	event.m_code = e->key();
+	postEvent(event);
+}
+
+void Tutorial03::keyReleaseEvent(QKeyEvent* e)
+{
+	if (e->isAutoRepeat())
+	{
+		return;
+	}
+	RenderEvent event;
+	event.m_type = RenderEvent::KeyRelease;
+	event.m_code = e->key();
+	postEvent(event);
 }
@@ -2,59 +2,145 @@
 
 #include <QtWidgets/QMainWindow>
 #include "ui_Tutorial03.h"
-#define VK_USE_PLATFORM_WIN32_KHR
-#include <vulkan/vulkan.h>
+#include "VulkanUtils.h"
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
+#include "SpscQueue.h"
+#include "DeletionQueue.h"
+#include "GpuProfiler.h"
+#include "Trace.h"
+#include "FrameStatistics.h"
+#include "MemoryTracker.h"
+#include "RenderGraph.h"
+#include "ReadbackRing.h"
+#include "DrawList.h"
+#include "StreamBuffer.h"
+#include "ImmediateBatcher.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
 
-struct SwapchainImage
+struct UniformBuffer
 {
-	VkImage m_image{ VK_NULL_HANDLE };
-	VkImageView m_imageView{ VK_NULL_HANDLE };
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
+	uint32_t m_size{ 0 };
+	uint32_t m_stride{ 0 };
+	VkMemoryPropertyFlags m_memoryFlags{ 0 };
+	void* m_mappedData{ nullptr };
 };
 
-struct VertexBuffer
+struct StagingBuffer
 {
 	VkBuffer m_buffer{ VK_NULL_HANDLE };
 	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
 	uint32_t m_size{ 0 };
+	VkMemoryPropertyFlags m_memoryFlags{ 0 };
+	void* m_mappedData{ nullptr };
 };
 
-struct UniformBuffer
+struct Texture
 {
-	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	VkImage m_image{ VK_NULL_HANDLE };
+	VkImageView m_imageView{ VK_NULL_HANDLE };
+	VkSampler m_sampler{ VK_NULL_HANDLE };
 	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
-	uint32_t m_size{ 0 };
 };
 
-struct RenderingResource
+struct DescriptorSet
 {
-	VkFramebuffer m_framebuffer{ VK_NULL_HANDLE };
-	VkCommandBuffer m_commandBuffer{ VK_NULL_HANDLE };
-	VkSemaphore m_imageAvailableSemaphore{ VK_NULL_HANDLE };
-	VkSemaphore m_renderingFinishedSemaphore{ VK_NULL_HANDLE };
-	VkFence m_fence{ VK_NULL_HANDLE };
+	VkDescriptorPool m_descriptorPool{ VK_NULL_HANDLE };
+	VkDescriptorSetLayout m_descriptorSetLayout{ VK_NULL_HANDLE };
+	std::vector<VkDescriptorSet> m_descriptorSets;
 };
 
-struct StagingBuffer
+struct RenderEvent
 {
-	VkBuffer m_buffer{ VK_NULL_HANDLE };
-	VkDeviceMemory m_deviceMemory{ VK_NULL_HANDLE };
-	uint32_t m_size{ 0 };
+	enum Type
+	{
+		MouseMove,
+		MousePress,
+		MouseRelease,
+		KeyPress,
+		KeyRelease,
+	};
+	Type m_type{ MouseMove };
+	int m_x{ 0 };
+	int m_y{ 0 };
+	int m_code{ 0 };
+	// nanoseconds on the Tracer::now() timeline
+	int64_t m_timestamp{ 0 };
 };
 
-struct Texture
+struct InputState
 {
-	VkImage m_image;
-	VkImageView m_imageView;
-	VkSampler m_sampler;
-	VkDeviceMemory m_deviceMemory;
+	int m_cursorX{ 0 };
+	int m_cursorY{ 0 };
+	uint32_t m_mouseButtons{ 0 };
+	std::unordered_set<int> m_pressedKeys;
 };
 
-struct DescriptorSet
+struct InputLatency
+{
+	uint32_t m_count{ 0 };
+	int64_t m_total{ 0 };
+	int64_t m_max{ 0 };
+};
+
+struct RenderSettings
+{
+	uint32_t m_framesInFlight{ 3 };
+	uint32_t m_swapChainImageCount{ 3 };
+	std::string m_statisticsCsvFile;
+	bool m_headless{ false };
+	uint32_t m_width{ 1280 };
+	uint32_t m_height{ 720 };
+	uint32_t m_quadCount{ 1 };
+	uint32_t m_textureCount{ 1 };
+	uint32_t m_materialCount{ 1 };
+	bool m_pipelineStatistics{ false };
+	uint32_t m_drawGroupSize{ 0 };
+	// write vertices and uniforms straight into device local host visible memory when there is some
+	bool m_directWrite{ true };
+	// rewrite every vertex each frame into a per frame region of the vertex buffer
+	bool m_dynamicVertices{ false };
+	// copy every frame into a ring of host cached buffers that is read back a few frames later
+	bool m_readback{ false };
+	// when set the frames read back are written there as ppm files
+	std::string m_captureDirectory;
+	// frames to capture from the start, 0 for every frame
+	uint32_t m_captureFrameCount{ 0 };
+	// samples per pixel, the multisampled color is transient and resolved inside the render pass
+	uint32_t m_sampleCount{ 1 };
+	// depth test the quads against a transient depth attachment
+	bool m_depth{ false };
+	// with depth, draw nearest quads first so early-Z rejects the hidden fragments
+	bool m_frontToBack{ true };
+	// stacks of quads over the same grid, each nearer than the one before
+	uint32_t m_quadLayers{ 1 };
+	// draw a frame time graph and quad outlines every frame as immediate mode geometry
+	bool m_debugOverlay{ false };
+	// when set this wavefront obj is drawn indexed instead of the quads
+	std::string m_meshFile;
+	// without a mesh file, a generated grid of this many cells a side is drawn as the mesh instead
+	uint32_t m_meshGridSize{ 0 };
+	// half float positions and texture coordinates, twelve bytes a vertex instead of twenty four
+	bool m_compactVertices{ false };
+	// positions in a stream of their own, texture coordinates in a second one
+	bool m_splitVertices{ false };
+	// lay down depth with a position only pass first, the color pass then shades visible fragments only
+	bool m_depthPrepass{ false };
+};
+
+struct MeshStatistics
 {
-	VkDescriptorPool m_descriptorPool;
-	VkDescriptorSetLayout m_descriptorSetLayout;
-	VkDescriptorSet m_descriptorSet;
+	uint32_t m_vertexCount{ 0 };
+	uint32_t m_triangleCount{ 0 };
+	// average cache miss ratio as loaded and after the load time reordering
+	float m_loadedAcmr{ 0.0f };
+	float m_optimizedAcmr{ 0.0f };
 };
 
 class Tutorial03 : public QMainWindow
@@ -62,27 +148,82 @@ class Tutorial03 : public QMainWindow
     Q_OBJECT
 
 public:
-    Tutorial03(QWidget *parent = nullptr);
+    Tutorial03(const RenderSettings& settings, QWidget *parent = nullptr);
     ~Tutorial03();
+	bool isReady() const;
+	bool renderFrame();
+	void resize(uint32_t width, uint32_t height);
+	bool reloadTexture();
+	bool waitIdle();
+	std::string deviceName() const;
+	std::vector<GpuScopeStatistics> gpuStatistics() const;
+	std::vector<GpuPipelineStatistics> gpuPipelineStatistics() const;
+	bool vertexDirectWrite() const;
+	uint64_t streamedVertexBytes() const;
+	uint32_t vertexSize() const;
+	uint32_t positionStride() const;
+	uint64_t readbackFrames() const;
+	uint64_t skippedReadbackFrames() const;
+	DrawListCounters drawListCounters() const;
+	DrawListCounters prepassCounters() const;
+	ImmediateStatistics overlayStatistics() const;
+	MeshStatistics meshStatistics() const;
+	uint32_t sampleCount() const;
+	bool multisampleMemoryLazy() const;
 private:
 	virtual void resizeEvent(QResizeEvent *) override;
-	virtual void timerEvent(QTimerEvent *event) override;
+	virtual void mouseMoveEvent(QMouseEvent* event) override;
+	virtual void mousePressEvent(QMouseEvent* event) override;
+	virtual void mouseReleaseEvent(QMouseEvent* event) override;
+	virtual void keyPressEvent(QKeyEvent* event) override;
+	virtual void keyReleaseEvent(QKeyEvent* event) override;
 private:
 	bool init();
 	bool createSwapChain();
+	bool createOffscreenTargets();
 	bool createRenderingResources();
 	bool createRenderPass();
+	bool createReadbackRing();
+	void writeCapture(const ReadbackFrame& frame);
 	bool createStagingBuffer();
 	bool createTexture();
+	bool createTextureImage(Texture& texture, uint32_t width, uint32_t height);
 	bool createVertexBuffer();
+	bool streamVertices(uint32_t resourceIndex, VkDeviceSize& vertexOffset);
+	void buildDrawList(VkDeviceSize vertexOffset);
+	bool createStreamBuffer();
+	bool createMesh();
+	void buildOverlay(uint32_t resourceIndex, float frameTime);
 	bool createUniformBuffer();
 	bool createDescriptorSet();
 	bool createPipeline();
 	void clear();
 	bool draw();
+	void abandonFrame(RenderingResource& renderingResource, uint32_t readbackSlot);
 	bool onSizeWindow();
-	VkShaderModule createShaderModule(const char* fileName);
+	bool waitForSerial(uint64_t serial, uint64_t timeout = UINT64_MAX);
+	void updateCompletedSerial();
+	bool submitAndWait(VkCommandBuffer commandBuffer);
+	void retire(std::function<void()> deleter);
+	void retireBuffer(VkBuffer& buffer, VkDeviceMemory& deviceMemory);
+	void retireTexture(Texture& texture);
+	void retireDescriptorSet(DescriptorSet& descriptorSet);
+	void retireSwapChain(VkSwapchainKHR swapChain, std::vector<SwapchainImage>& images);
+	void retirePipeline();
+	void startRenderThread();
+	void stopRenderThread();
+	void renderLoop();
+	void processEvents();
+	void postEvent(RenderEvent event);
+	void recordInputLatency(int64_t latency);
+	void reportStatistics();
+	void evictMemory(uint32_t heapIndex, const MemoryHeapUsage& usage);
+	void dumpTrace();
+	void reportError(const QString& message);
 private:
+	RenderSettings m_settings;
+	bool m_ready{ false };
+	VkInstance m_instance{ VK_NULL_HANDLE };
 	VkSurfaceKHR m_surface{ VK_NULL_HANDLE };
 	VkSwapchainKHR m_swapChain{ VK_NULL_HANDLE };
 	VkFormat m_swapChainFormat{ VK_FORMAT_UNDEFINED };
@@ -95,16 +236,70 @@ private:
 	VkQueue m_presentQueue{ VK_NULL_HANDLE };
 	VkCommandPool m_graphicsCommandPool{ VK_NULL_HANDLE };
 	std::vector<SwapchainImage> m_swapChainImages;
-	static const uint32_t rendering_resource_count = 3;
-	RenderingResource  m_renderingResources[rendering_resource_count];
+	bool m_swapChainDirty{ false };
+	std::vector<RenderingResource> m_renderingResources;
+	uint32_t m_resourceIndex{ 0 };
+	uint64_t m_submittedSerial{ 0 };
+	uint64_t m_completedSerial{ 0 };
+	DeletionQueue m_deletionQueue;
+	MemoryTracker m_memoryTracker;
+	GpuProfiler m_gpuProfiler;
+	RenderGraph m_renderGraph;
+	RenderGraph m_uploadGraph;
+	ReadbackRing m_readbackRing;
+	uint64_t m_frameNumber{ 0 };
+	uint32_t m_uploadProfilerSlot{ 0 };
+	FrameStatistics m_frameStatistics;
+	int64_t m_lastFrameStart{ 0 };
+	std::chrono::steady_clock::time_point m_lastStatisticsReport;
+	VkCommandBuffer m_uploadCommandBuffer{ VK_NULL_HANDLE };
+	VkFence m_uploadFence{ VK_NULL_HANDLE };
+	bool m_timelineSemaphoreSupported{ false };
+	VkSemaphore m_timelineSemaphore{ VK_NULL_HANDLE };
+	PFN_vkWaitSemaphoresKHR m_vkWaitSemaphoresKHR{ nullptr };
+	PFN_vkGetSemaphoreCounterValueKHR m_vkGetSemaphoreCounterValueKHR{ nullptr };
+	PFN_vkGetCalibratedTimestampsEXT m_vkGetCalibratedTimestampsEXT{ nullptr };
+	VkTimeDomainEXT m_hostTimeDomain{ VK_TIME_DOMAIN_DEVICE_EXT };
+	bool m_pipelineStatisticsQuery{ false };
+	VkSampleCountFlagBits m_sampleCount{ VK_SAMPLE_COUNT_1_BIT };
+	VkFormat m_depthFormat{ VK_FORMAT_UNDEFINED };
+	DrawList m_drawList;
+	DrawBindings m_drawBindings;
+	StreamBuffer m_streamBuffer;
+	ImmediateBatcher m_overlayBatcher;
+	DrawList m_overlayDrawList;
+	DrawBindings m_overlayBindings;
+	std::vector<VkPipeline> m_overlayPipelines;
+	std::vector<VkPipeline> m_prepassPipelines;
+	DrawBindings m_prepassBindings;
+	DrawListCounters m_prepassCounters;
+	std::vector<float> m_overlayFrameTimes;
+	uint32_t m_overlayFrame{ 0 };
+	bool m_multisampleLazy{ false };
 	VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
 	StagingBuffer m_stagingBuffer;
+	VertexLayout m_vertexLayout;
 	VertexBuffer m_vertexBuffer;
+	StagingBuffer m_vertexStagingBuffer;
+	VertexBuffer m_meshVertexBuffer;
+	VertexBuffer m_meshIndexBuffer;
+	MeshStatistics m_meshStatistics;
+	uint64_t m_streamedFrames{ 0 };
+	uint64_t m_streamedVertexBytes{ 0 };
 	UniformBuffer m_uniformBuffer;
-	Texture m_texture;
+	std::vector<Texture> m_textures;
 	DescriptorSet m_descriptorSet;
 	VkRenderPass m_renderPass{ VK_NULL_HANDLE };
 	VkPipeline m_pipeline{ VK_NULL_HANDLE };
+	VkPipeline m_meshPipeline{ VK_NULL_HANDLE };
+	std::thread m_renderThread;
+	std::atomic<bool> m_renderThreadRunning{ false };
+	SpscQueue<RenderEvent, 256> m_eventQueue;
+	// resizes are coalesced into a flag rather than queued so a full queue can never lose one
+	std::atomic<bool> m_resizePending{ false };
+	InputState m_inputState;
+	int64_t m_pendingInputTimestamp{ 0 };
+	InputLatency m_inputLatency;
 private:
     Ui::Tutorial03Class ui;
 };
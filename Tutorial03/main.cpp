@@ -1,10 +1,76 @@
 #include "Tutorial03.h"
 #include <QtWidgets/QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    Tutorial03 w;
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption framesInFlightOption("frames-in-flight", "number of frames recorded ahead of the GPU (1-4)", "count", "3");
+    QCommandLineOption swapChainImagesOption("swapchain-images", "desired number of swapchain images (2-5)", "count", "3");
+    parser.addOption(framesInFlightOption);
+    QCommandLineOption statisticsCsvOption("stats-csv", "write per-frame timings to a csv file on exit", "file");
+    QCommandLineOption pipelineStatisticsOption("pipeline-statistics", "collect pipeline statistics queries per draw group");
+    QCommandLineOption drawGroupSizeOption("draw-group-size", "quads per pipeline statistics draw group, 0 for one group", "count", "0");
+    QCommandLineOption noDirectWriteOption("no-direct-write", "always upload vertices and uniforms through staging copies");
+    QCommandLineOption dynamicVerticesOption("dynamic-vertices", "rewrite the vertex buffer every frame");
+    QCommandLineOption captureOption("capture", "read every frame back and write it as a ppm file into a directory", "directory");
+    QCommandLineOption msaaOption("msaa", "samples per pixel (1, 2, 4 or 8)", "samples", "1");
+    QCommandLineOption depthOption("depth", "depth test the quads");
+    QCommandLineOption unsortedOption("unsorted", "keep the submission order instead of drawing front to back");
+    QCommandLineOption quadLayersOption("quad-layers", "stacked layers of quads over the same grid", "count", "1");
+    QCommandLineOption overlayOption("overlay", "draw a frame time graph and quad outlines as immediate mode geometry");
+    QCommandLineOption meshOption("mesh", "draw an indexed wavefront obj mesh instead of the quads", "file");
+    QCommandLineOption meshGridOption("mesh-grid", "without --mesh, draw a generated grid mesh of this many cells a side (up to 1024)", "cells", "0");
+    QCommandLineOption compactVerticesOption("compact-vertices", "store positions and texture coordinates as half floats");
+    QCommandLineOption splitVerticesOption("split-vertices", "keep positions and texture coordinates in separate vertex streams");
+    QCommandLineOption depthPrepassOption("depth-prepass", "draw depth with a position only pass before shading, implies --depth");
+    QCommandLineOption captureFramesOption("capture-frames", "number of frames to capture from the start, 0 for every frame", "count", "0");
+    parser.addOption(swapChainImagesOption);
+    parser.addOption(statisticsCsvOption);
+    parser.addOption(pipelineStatisticsOption);
+    parser.addOption(drawGroupSizeOption);
+    parser.addOption(noDirectWriteOption);
+    parser.addOption(dynamicVerticesOption);
+    parser.addOption(captureOption);
+    parser.addOption(captureFramesOption);
+    parser.addOption(msaaOption);
+    parser.addOption(depthOption);
+    parser.addOption(unsortedOption);
+    parser.addOption(quadLayersOption);
+    parser.addOption(overlayOption);
+    parser.addOption(meshOption);
+    parser.addOption(meshGridOption);
+    parser.addOption(compactVerticesOption);
+    parser.addOption(splitVerticesOption);
+    parser.addOption(depthPrepassOption);
+    parser.process(a);
+
+    RenderSettings settings;
+    settings.m_framesInFlight = parser.value(framesInFlightOption).toUInt();
+    settings.m_swapChainImageCount = parser.value(swapChainImagesOption).toUInt();
+    settings.m_statisticsCsvFile = parser.value(statisticsCsvOption).toStdString();
+    settings.m_pipelineStatistics = parser.isSet(pipelineStatisticsOption);
+    settings.m_drawGroupSize = parser.value(drawGroupSizeOption).toUInt();
+    settings.m_directWrite = !parser.isSet(noDirectWriteOption);
+    settings.m_dynamicVertices = parser.isSet(dynamicVerticesOption);
+    settings.m_readback = parser.isSet(captureOption);
+    settings.m_captureDirectory = parser.value(captureOption).toStdString();
+    settings.m_captureFrameCount = parser.value(captureFramesOption).toUInt();
+    settings.m_sampleCount = parser.value(msaaOption).toUInt();
+    settings.m_depth = parser.isSet(depthOption);
+    settings.m_frontToBack = !parser.isSet(unsortedOption);
+    settings.m_quadLayers = parser.value(quadLayersOption).toUInt();
+    settings.m_debugOverlay = parser.isSet(overlayOption);
+    settings.m_meshFile = parser.value(meshOption).toStdString();
+    settings.m_meshGridSize = parser.value(meshGridOption).toUInt();
+    settings.m_compactVertices = parser.isSet(compactVerticesOption);
+    settings.m_splitVertices = parser.isSet(splitVerticesOption);
+    settings.m_depthPrepass = parser.isSet(depthPrepassOption);
+
+    Tutorial03 w(settings);
     w.show();
     return a.exec();
 }
@@ -17,6 +17,7 @@ out gl_PerVertex
 {
   vec4 gl_Position;
 };
+invariant gl_Position;
 
 layout(location = 0) out vec2 v_Texcoord;
 
@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec4 i_Position;
+
+out gl_PerVertex
+{
+  vec4 gl_Position;
+};
+invariant gl_Position;
+
+void main() {
+    gl_Position = i_Position;
+}
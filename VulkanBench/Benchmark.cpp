@@ -0,0 +1,290 @@
+#include "Benchmark.h"
+#include <fstream>
+
+// modelled, not measured, bytes per frame between the color attachments and memory. a tiler with
+// lazily allocated samples only writes the resolved pixels, an immediate renderer writes every
+// sample and reads them back to resolve. a post-process aa pass writes the aliased frame, reads
+// it back, its neighbourhood fetches mostly hitting the cache, and writes the filtered frame
+static double AttachmentMegabytes(uint32_t width, uint32_t height, uint32_t sampleCount, bool lazy)
+{
+	double pixelBytes = width * height * 4.0;
+	double bytes = (sampleCount > 1 && !lazy) ? pixelBytes * (2 * sampleCount + 1) : pixelBytes;
+	return bytes / (1024.0 * 1024.0);
+}
+
+static double PostProcessMegabytes(uint32_t width, uint32_t height)
+{
+	return width * height * 4.0 * 3 / (1024.0 * 1024.0);
+}
+
+std::vector<BenchScenario> DefaultScenarios(uint32_t width, uint32_t height, uint32_t frameCount, bool pipelineStatistics)
+{
+	std::vector<BenchScenario> scenarios;
+	auto addScenario = [&](const char* name, uint32_t quadCount, uint32_t textureCount, uint32_t materialCount) -> BenchScenario& {
+		BenchScenario scenario;
+		scenario.m_name = name;
+		scenario.m_settings.m_headless = true;
+		scenario.m_settings.m_width = width;
+		scenario.m_settings.m_height = height;
+		scenario.m_settings.m_quadCount = quadCount;
+		scenario.m_settings.m_textureCount = textureCount;
+		scenario.m_settings.m_materialCount = materialCount;
+		scenario.m_settings.m_pipelineStatistics = pipelineStatistics;
+		scenario.m_settings.m_drawGroupSize = (quadCount + 3) / 4;
+		scenario.m_frameCount = frameCount;
+		scenarios.push_back(scenario);
+		return scenarios.back();
+	};
+	// draw and state change scaling
+	addScenario("baseline", 1, 1, 1);
+	addScenario("quads_1k", 1024, 1, 1);
+	addScenario("quads_16k", 16384, 1, 1);
+	addScenario("textures_64", 256, 64, 64);
+	addScenario("materials_1k", 4096, 1, 1024);
+	// upload storms reload every texture each m_uploadInterval frames, resize storms cycle through a fixed size table
+	addScenario("upload_storm", 256, 4, 4).m_uploadInterval = 1;
+	addScenario("resize_storm", 256, 1, 1).m_resizeInterval = 5;
+	// every vertex rewritten each frame, once direct and once through staging copies
+	addScenario("stream_direct", 16384, 1, 1).m_settings.m_dynamicVertices = true;
+	BenchScenario& streamStaging = addScenario("stream_staging", 16384, 1, 1);
+	streamStaging.m_settings.m_dynamicVertices = true;
+	streamStaging.m_settings.m_directWrite = false;
+	// every frame copied back to the host without being written anywhere
+	addScenario("readback", 256, 1, 1).m_settings.m_readback = true;
+	// attachment traffic next to that of a post-process aa pass, both modelled rather than measured
+	addScenario("msaa_4x", 256, 1, 1).m_settings.m_sampleCount = 4;
+	addScenario("msaa_8x", 256, 1, 1).m_settings.m_sampleCount = 8;
+	// every quad outlined with immediate mode lines, reporting the draws they were batched into
+	addScenario("overlay", 4096, 16, 16).m_settings.m_debugOverlay = true;
+	// eight layers of quads, fragments per pixel come from pipeline statistics
+	for (bool frontToBack : { false, true })
+	{
+		BenchScenario& overdraw = addScenario(frontToBack ? "overdraw_sorted" : "overdraw_unsorted", 8192, 1, 1);
+		overdraw.m_settings.m_depth = true;
+		overdraw.m_settings.m_frontToBack = frontToBack;
+		overdraw.m_settings.m_quadLayers = 8;
+		overdraw.m_settings.m_pipelineStatistics = true;
+	}
+	// the largest quad count streamed once as floats and once as halves
+	for (bool compact : { false, true })
+	{
+		BenchScenario& vertices = addScenario(compact ? "vertices_compact" : "vertices_full", 65536, 1, 1);
+		vertices.m_settings.m_dynamicVertices = true;
+		vertices.m_settings.m_compactVertices = compact;
+	}
+	// a static two million triangle grid, vertex fetch shows in the gpu time of the main pass
+	for (bool compact : { false, true })
+	{
+		BenchScenario& mesh = addScenario(compact ? "mesh_compact" : "mesh_full", 1, 1, 1);
+		mesh.m_settings.m_meshGridSize = 1024;
+		mesh.m_settings.m_compactVertices = compact;
+	}
+	// a position only depth pass over the overdraw stack, from interleaved vertices or a stream of its own
+	for (bool split : { false, true })
+	{
+		BenchScenario& prepass = addScenario(split ? "prepass_split" : "prepass_interleaved", 8192, 1, 1);
+		prepass.m_settings.m_depthPrepass = true;
+		prepass.m_settings.m_splitVertices = split;
+		prepass.m_settings.m_quadLayers = 8;
+		prepass.m_settings.m_pipelineStatistics = true;
+	}
+	return scenarios;
+}
+
+bool RunScenario(const BenchScenario& scenario, BenchResult& result, std::string& deviceName)
+{
+	result = BenchResult();
+	result.m_name = scenario.m_name;
+
+	Tutorial03 renderer(scenario.m_settings);
+	if (!renderer.isReady())
+	{
+		return false;
+	}
+	deviceName = renderer.deviceName();
+
+	const uint32_t resizes[][2] =
+	{
+		{ scenario.m_settings.m_width, scenario.m_settings.m_height },
+		{ scenario.m_settings.m_width / 2, scenario.m_settings.m_height / 2 },
+		{ scenario.m_settings.m_width * 3 / 4, scenario.m_settings.m_height },
+		{ scenario.m_settings.m_width, scenario.m_settings.m_height * 3 / 4 },
+	};
+	uint32_t resizeCount = 0;
+
+	Histogram frameTimes;
+	int64_t benchStart = 0;
+	uint64_t streamedStart = 0;
+	uint64_t readbackStart = 0;
+	uint64_t skippedReadbackStart = 0;
+	uint32_t totalFrames = scenario.m_warmupFrames + scenario.m_frameCount;
+	for (uint32_t frame = 0; frame < totalFrames; ++frame)
+	{
+		if (frame == scenario.m_warmupFrames)
+		{
+			benchStart = Tracer::now();
+			streamedStart = renderer.streamedVertexBytes();
+			readbackStart = renderer.readbackFrames();
+			skippedReadbackStart = renderer.skippedReadbackFrames();
+		}
+		int64_t frameStart = Tracer::now();
+		if (scenario.m_uploadInterval > 0 && frame % scenario.m_uploadInterval == 0 && !renderer.reloadTexture())
+		{
+			return false;
+		}
+		if (scenario.m_resizeInterval > 0 && frame % scenario.m_resizeInterval == 0)
+		{
+			++resizeCount;
+			renderer.resize(resizes[resizeCount % 4][0], resizes[resizeCount % 4][1]);
+		}
+		if (!renderer.renderFrame())
+		{
+			return false;
+		}
+		if (frame >= scenario.m_warmupFrames)
+		{
+			frameTimes.record((Tracer::now() - frameStart) / 1000);
+		}
+	}
+	if (!renderer.waitIdle())
+	{
+		return false;
+	}
+
+	result.m_success = true;
+	result.m_frameCount = scenario.m_frameCount;
+	result.m_seconds = (Tracer::now() - benchStart) / 1e9;
+	result.m_vertexDirectWrite = renderer.vertexDirectWrite();
+	result.m_streamedVertexBytes = renderer.streamedVertexBytes() - streamedStart;
+	result.m_vertexSize = renderer.vertexSize();
+	result.m_positionStride = renderer.positionStride();
+	result.m_readbackFrames = renderer.readbackFrames() - readbackStart;
+	result.m_skippedReadbackFrames = renderer.skippedReadbackFrames() - skippedReadbackStart;
+	result.m_sampleCount = renderer.sampleCount();
+	result.m_multisampleLazy = renderer.multisampleMemoryLazy();
+	result.m_attachmentMegabytes = AttachmentMegabytes(scenario.m_settings.m_width, scenario.m_settings.m_height, result.m_sampleCount, result.m_multisampleLazy);
+	result.m_postProcessMegabytes = PostProcessMegabytes(scenario.m_settings.m_width, scenario.m_settings.m_height);
+	result.m_frameTime.m_count = frameTimes.count();
+	result.m_frameTime.m_p50 = frameTimes.percentile(50.0);
+	result.m_frameTime.m_p95 = frameTimes.percentile(95.0);
+	result.m_frameTime.m_p99 = frameTimes.percentile(99.0);
+	result.m_frameTime.m_max = frameTimes.maximum();
+	result.m_gpuScopes = renderer.gpuStatistics();
+	result.m_pipelineStatistics = renderer.gpuPipelineStatistics();
+	result.m_drawListCounters = renderer.drawListCounters();
+	result.m_prepassCounters = renderer.prepassCounters();
+	result.m_overlayStatistics = renderer.overlayStatistics();
+	result.m_meshStatistics = renderer.meshStatistics();
+	double fragmentInvocations = 0;
+	for (const GpuPipelineStatistics& statistics : result.m_pipelineStatistics)
+	{
+		fragmentInvocations += statistics.m_fragmentInvocations;
+	}
+	result.m_fragmentsPerPixel = fragmentInvocations / (static_cast<double>(scenario.m_settings.m_width) * scenario.m_settings.m_height);
+	return true;
+}
+
+// quotes, backslashes and control characters escaped for a json string
+static std::string JsonString(const std::string& value)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+	std::string escaped;
+	for (char c : value)
+	{
+		unsigned char code = static_cast<unsigned char>(c);
+		if ('"' == c || '\\' == c)
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (code < 0x20)
+		{
+			escaped += "\\u00";
+			escaped += hex_digits[code >> 4];
+			escaped += hex_digits[code & 0xf];
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+bool WriteBenchJson(const std::string& fileName, const std::string& deviceName, const std::vector<BenchResult>& results)
+{
+	std::ofstream file(fileName);
+	if (file.fail())
+	{
+		return false;
+	}
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	file << "{\n\"device\":\"" << JsonString(deviceName) << "\",\n\"scenarios\":[\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult& result = results[i];
+		// bind counters are those of the last frame's draw list, its prepass recording counted apart
+		file << (i == 0 ? "" : ",\n") << "{\"name\":\"" << result.m_name << "\""
+			<< ",\"success\":" << (result.m_success ? "true" : "false")
+			<< ",\"frames\":" << result.m_frameCount
+			<< ",\"seconds\":" << result.m_seconds
+			<< ",\"fps\":" << (result.m_seconds > 0 ? result.m_frameCount / result.m_seconds : 0.0)
+			<< ",\"vertex_direct_write\":" << (result.m_vertexDirectWrite ? "true" : "false")
+			<< ",\"vertex_bytes\":" << result.m_vertexSize
+			<< ",\"position_stride\":" << result.m_positionStride
+			<< ",\"streamed_vertex_mb_per_s\":" << (result.m_seconds > 0 ? result.m_streamedVertexBytes / (1024.0 * 1024.0) / result.m_seconds : 0.0)
+			<< ",\"readback_frames\":" << result.m_readbackFrames
+			<< ",\"readback_skipped\":" << result.m_skippedReadbackFrames
+			<< ",\"msaa_samples\":" << result.m_sampleCount
+			<< ",\"msaa_lazy_memory\":" << (result.m_multisampleLazy ? "true" : "false")
+			<< ",\"modelled_mb_per_frame\":{\"attachments\":" << result.m_attachmentMegabytes
+			<< ",\"post_aa\":" << result.m_postProcessMegabytes << "}"
+			<< ",\"fragments_per_pixel\":" << result.m_fragmentsPerPixel
+			<< ",\"binds\":{\"draws\":" << result.m_drawListCounters.m_draws
+			<< ",\"pipeline\":" << result.m_drawListCounters.m_pipelineBinds
+			<< ",\"pipeline_avoided\":" << result.m_drawListCounters.m_pipelineBindsAvoided
+			<< ",\"descriptor_set\":" << result.m_drawListCounters.m_descriptorSetBinds
+			<< ",\"descriptor_set_avoided\":" << result.m_drawListCounters.m_descriptorSetBindsAvoided
+			<< ",\"vertex_buffer\":" << result.m_drawListCounters.m_vertexBufferBinds
+			<< ",\"vertex_buffer_avoided\":" << result.m_drawListCounters.m_vertexBufferBindsAvoided << "}"
+			<< ",\"prepass_binds\":{\"draws\":" << result.m_prepassCounters.m_draws
+			<< ",\"pipeline\":" << result.m_prepassCounters.m_pipelineBinds
+			<< ",\"vertex_buffer\":" << result.m_prepassCounters.m_vertexBufferBinds << "}"
+			<< ",\"mesh\":{\"vertices\":" << result.m_meshStatistics.m_vertexCount
+			<< ",\"triangles\":" << result.m_meshStatistics.m_triangleCount
+			<< ",\"acmr_loaded\":" << result.m_meshStatistics.m_loadedAcmr
+			<< ",\"acmr\":" << result.m_meshStatistics.m_optimizedAcmr << "}"
+			<< ",\"overlay\":{\"primitives\":" << result.m_overlayStatistics.m_primitives
+			<< ",\"draws\":" << result.m_overlayStatistics.m_batches
+			<< ",\"dropped\":" << result.m_overlayStatistics.m_droppedPrimitives
+			<< ",\"kb\":" << result.m_overlayStatistics.m_bytes / 1024.0 << "}"
+			<< ",\"frame_time_us\":{\"p50\":" << result.m_frameTime.m_p50
+			<< ",\"p95\":" << result.m_frameTime.m_p95
+			<< ",\"p99\":" << result.m_frameTime.m_p99
+			<< ",\"max\":" << result.m_frameTime.m_max << "}"
+			<< ",\"gpu_ms\":{";
+		for (size_t j = 0; j < result.m_gpuScopes.size(); ++j)
+		{
+			const GpuScopeStatistics& scope = result.m_gpuScopes[j];
+			file << (j == 0 ? "" : ",") << "\"" << scope.m_name << "\":{\"samples\":" << scope.m_sampleCount
+				<< ",\"min\":" << scope.m_min
+				<< ",\"avg\":" << scope.m_average
+				<< ",\"p99\":" << scope.m_p99 << "}";
+		}
+		file << "},\"pipeline_statistics\":{";
+		for (size_t j = 0; j < result.m_pipelineStatistics.size(); ++j)
+		{
+			const GpuPipelineStatistics& group = result.m_pipelineStatistics[j];
+			file << (j == 0 ? "" : ",") << "\"" << group.m_name << "\":{\"samples\":" << group.m_sampleCount
+				<< ",\"input_primitives\":" << group.m_inputPrimitives
+				<< ",\"vertex_invocations\":" << group.m_vertexInvocations
+				<< ",\"clipping_invocations\":" << group.m_clippingInvocations
+				<< ",\"clipping_primitives\":" << group.m_clippingPrimitives
+				<< ",\"fragment_invocations\":" << group.m_fragmentInvocations << "}";
+		}
+		file << "}}";
+	}
+	file << "\n]}\n";
+	return !file.fail();
+}
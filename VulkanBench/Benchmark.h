@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Tutorial03.h"
+#include <string>
+#include <vector>
+
+struct BenchScenario
+{
+	std::string m_name;
+	RenderSettings m_settings;
+	uint32_t m_warmupFrames{ 30 };
+	uint32_t m_frameCount{ 300 };
+	uint32_t m_uploadInterval{ 0 };
+	uint32_t m_resizeInterval{ 0 };
+};
+
+struct BenchResult
+{
+	std::string m_name;
+	bool m_success{ false };
+	uint32_t m_frameCount{ 0 };
+	double m_seconds{ 0 };
+	bool m_vertexDirectWrite{ false };
+	uint64_t m_streamedVertexBytes{ 0 };
+	uint32_t m_vertexSize{ 0 };
+	uint32_t m_positionStride{ 0 };
+	uint64_t m_readbackFrames{ 0 };
+	uint64_t m_skippedReadbackFrames{ 0 };
+	uint32_t m_sampleCount{ 1 };
+	bool m_multisampleLazy{ false };
+	double m_attachmentMegabytes{ 0 };
+	double m_postProcessMegabytes{ 0 };
+	double m_fragmentsPerPixel{ 0 };
+	DrawListCounters m_drawListCounters;
+	DrawListCounters m_prepassCounters;
+	ImmediateStatistics m_overlayStatistics;
+	MeshStatistics m_meshStatistics;
+	MetricSummary m_frameTime;
+	std::vector<GpuScopeStatistics> m_gpuScopes;
+	std::vector<GpuPipelineStatistics> m_pipelineStatistics;
+};
+
+// scenarios are fully described by their settings and frame counts, RunScenario renders one
+// headless and WriteBenchJson writes every result next to the device name
+std::vector<BenchScenario> DefaultScenarios(uint32_t width, uint32_t height, uint32_t frameCount, bool pipelineStatistics);
+bool RunScenario(const BenchScenario& scenario, BenchResult& result, std::string& deviceName);
+bool WriteBenchJson(const std::string& fileName, const std::string& deviceName, const std::vector<BenchResult>& results);
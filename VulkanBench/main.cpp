@@ -0,0 +1,67 @@
+#include "Benchmark.h"
+#include <QtWidgets/QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption outputOption("output", "json file receiving the results", "file", "bench.json");
+    QCommandLineOption framesOption("frames", "measured frames per scenario", "count", "300");
+    QCommandLineOption widthOption("width", "render target width", "pixels", "1280");
+    QCommandLineOption heightOption("height", "render target height", "pixels", "720");
+    QCommandLineOption scenarioOption("scenario", "run only the named scenario, may be repeated", "name");
+    QCommandLineOption listOption("list", "list the scenarios and exit");
+    QCommandLineOption pipelineStatisticsOption("pipeline-statistics", "collect pipeline statistics for four draw groups per scenario");
+    parser.addOption(outputOption);
+    parser.addOption(framesOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    parser.addOption(scenarioOption);
+    parser.addOption(listOption);
+    parser.addOption(pipelineStatisticsOption);
+    parser.process(a);
+
+    std::vector<BenchScenario> scenarios = DefaultScenarios(parser.value(widthOption).toUInt(), parser.value(heightOption).toUInt(), parser.value(framesOption).toUInt(), parser.isSet(pipelineStatisticsOption));
+    if (parser.isSet(listOption))
+    {
+        for (const BenchScenario& scenario : scenarios)
+        {
+            qInfo().noquote() << scenario.m_name.c_str();
+        }
+        return 0;
+    }
+
+    QStringList selected = parser.values(scenarioOption);
+    std::string deviceName;
+    std::vector<BenchResult> results;
+    bool success = true;
+    for (const BenchScenario& scenario : scenarios)
+    {
+        if (!selected.isEmpty() && !selected.contains(scenario.m_name.c_str()))
+        {
+            continue;
+        }
+        BenchResult result;
+        if (!RunScenario(scenario, result, deviceName))
+        {
+            qWarning() << "scenario" << scenario.m_name.c_str() << "failed";
+            success = false;
+        }
+        else
+        {
+            qInfo() << scenario.m_name.c_str() << "p50" << result.m_frameTime.m_p50 << "p99" << result.m_frameTime.m_p99 << "us";
+        }
+        results.push_back(result);
+    }
+
+    if (!WriteBenchJson(parser.value(outputOption).toStdString(), deviceName, results))
+    {
+        qWarning() << "could not write" << parser.value(outputOption);
+        return 1;
+    }
+    return success ? 0 : 1;
+}